@@ -0,0 +1,61 @@
+#!/bin/bash
+
+# Scaling benchmark on generated landscapes. Each size is solved twice with the
+# same seed (1 and ITERS iterations); the difference isolates the search from
+# instance loading. Peak RSS needs GNU time (/usr/bin/time).
+
+set -e
+
+run() {
+    local exe=$1
+    local instance=$2
+    local iters=$3
+    local out
+    if [ -x /usr/bin/time ]; then
+        out=$(/usr/bin/time -f "%M" -o rss.tmp ${exe} --instance ${instance} --maxiter ${iters} --timelimit ${TIMELIMIT} ${ARGS})
+        RSS=$(cat rss.tmp)
+        rm -f rss.tmp
+    else
+        out=$(${exe} --instance ${instance} --maxiter ${iters} --timelimit ${TIMELIMIT} ${ARGS})
+        RSS=NA
+    fi
+    ITERATIONS=$(echo "${out}" | cut -d, -f12)
+    BUDGET=$(echo "${out}" | cut -d, -f14)
+}
+
+bench() {
+    local size=$1
+    local instance=${LANDSCAPES}/G${size}_${NEIGHBORS}.bin
+    if [ ! -f ${instance} ]; then
+        ${GENERATE} --output ${LANDSCAPES}/G${size}_${NEIGHBORS}.json --width ${size} --height ${size} --neighbors ${NEIGHBORS} --seed 1 > /dev/null
+        ${CONVERT} ${LANDSCAPES}/G${size}_${NEIGHBORS}.json > /dev/null
+    fi
+    local t0=$(date +%s.%N)
+    run ${EXE} ${instance} 1
+    local t1=$(date +%s.%N)
+    local b1=${BUDGET}
+    run ${EXE} ${instance} ${ITERS}
+    local t2=$(date +%s.%N)
+    awk -v s=${size} -v i=${ITERATIONS} -v t0=${t0} -v t1=${t1} -v t2=${t2} -v b1=${b1} -v b=${BUDGET} -v rss=${RSS} 'BEGIN {
+        dt = (t2 - t1) - (t1 - t0)
+        printf "%s,%d,%.3f,%.3f,%.1f,%s\n", s, i, t1 - t0, dt / (i - 1), (b - b1) / dt, rss
+    }'
+}
+
+ROOT=$(git rev-parse --show-toplevel)
+EXE="${ROOT}/build/fire"
+GENERATE="${ROOT}/build/fire-generate"
+CONVERT="${ROOT}/build/fire-convert"
+LANDSCAPES="${ROOT}/experiments/landscapes"
+SIZES=${SIZES:-"100 250 500 1000 2000"}
+NEIGHBORS=${NEIGHBORS:-4}
+ITERS=${ITERS:-3}
+TIMELIMIT=${TIMELIMIT:-3600}
+ARGS=${ARGS:-"--beta 10 --eta 10 --c 1 --seed 1"}
+
+${ROOT}/configure.sh > /dev/null
+mkdir -p ${LANDSCAPES}
+echo "size,iterations,first_iteration_s,s_per_iteration,budget_per_s,peak_rss_kb" > benchmark.csv
+for size in ${SIZES}; do
+    bench ${size} | tee -a benchmark.csv
+done
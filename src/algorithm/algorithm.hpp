@@ -1,11 +1,15 @@
+#pragma once
+
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
 #include <vector>
 #include <algorithm>
 #include <iterator>
 #include <set>
 #include <cmath>
+#include <span>
 #include <string>
 using namespace std;
 
@@ -17,13 +21,125 @@ using namespace boost::heap;
 #include "shortest_path_tree.hpp"
 #include "heap.hpp"
 #include "feasibility.hpp"
+#include "thread_pool.hpp"
+#include "sparse_set.hpp"
+#include "fingerprint_set.hpp"
+#include "profiler.hpp"
+#include "top_k.hpp"
+#include "scenarios.hpp"
+#include "scenario_evaluator.hpp"
+#include "transposition_table.hpp"
+#include "deadline.hpp"
 
 constexpr int INF = numeric_limits<int>::max();
 
 class Algorithm {
    private:
-    // Budget counter
-    unsigned long long int _budget;
+    // Arrival times, predecessors and resources changed by one trial on top of a parent that
+    // stays read-only (see delta_overlaid). A node belongs to the overlay while its stamp equals
+    // the epoch, so starting the next trial is a single increment.
+    struct Overlay {
+        vector<unsigned> a, p, stamp, resource;
+        unsigned epoch = 0;
+
+        void begin(unsigned n) {
+            if (stamp.size() != n) {
+                a.resize(n);
+                p.resize(n);
+                stamp.assign(n, 0);
+                resource.assign(n, 0);
+                epoch = 0;
+            }
+            if (++epoch == 0) {
+                fill(stamp.begin(), stamp.end(), 0);
+                fill(resource.begin(), resource.end(), 0);
+                epoch = 1;
+            }
+        }
+    };
+
+    // How update_subtree() reads and writes a solution: in place, or through an overlay
+    struct InPlace {
+        ShortestPathTree& spt;
+        const ResourceSet& has_resource;
+        inline unsigned a(unsigned u) const { return spt.a[u]; }
+        inline unsigned p(unsigned u) const { return spt.p[u]; }
+        inline bool resource(unsigned u) const { return has_resource[u]; }
+        inline void set_a(unsigned u, unsigned value) { spt.a[u] = value; }
+        inline void set_p(unsigned u, unsigned value) { spt.p[u] = value; }
+    };
+
+    struct Overlaid {
+        const ShortestPathTree& spt;
+        const ResourceSet& has_resource;
+        Overlay& ov;
+        inline bool owned(unsigned u) const { return ov.stamp[u] == ov.epoch; }
+        inline unsigned a(unsigned u) const { return owned(u) ? ov.a[u] : spt.a[u]; }
+        inline unsigned p(unsigned u) const { return owned(u) ? ov.p[u] : spt.p[u]; }
+        inline bool resource(unsigned u) const { return has_resource[u] || ov.resource[u] == ov.epoch; }
+        inline void own(unsigned u) {
+            if (!owned(u)) {
+                ov.stamp[u] = ov.epoch;
+                ov.a[u] = spt.a[u];
+                ov.p[u] = spt.p[u];
+            }
+        }
+        inline void set_a(unsigned u, unsigned value) { own(u); ov.a[u] = value; }
+        inline void set_p(unsigned u, unsigned value) { own(u); ov.p[u] = value; }
+    };
+
+    // Unique trial of step() in trial-parallel mode, scored after all trials are drawn
+    struct Trial {
+        uint64_t fingerprint;
+        unsigned h1, h2;
+    };
+
+    // Per-thread search context. The scratch buffers are cleared rather than freed, so
+    // once they have grown to the working size step() and the SPT updates stop allocating.
+    struct Worker {
+        mt19937 gen;
+        Heap heap;
+        unsigned long long int budget;
+        Profile profile;
+        // Scratch of step()
+        SparseSet F, N, N_copy;
+        FingerprintSet cache;
+        vector<unsigned> to_remove_N, to_insert_N, to_insert_F, selection;
+        TopK<unsigned> best;         // Scores of the best trials; payloads are indexed by slot
+        vector<unsigned> candidates; // Selections of the kept trials, 'picks' nodes per slot
+        vector<pair<unsigned, unsigned>> metrics;
+        vector<uint64_t> fingerprints;
+        vector<Trial> trials;         // Trial-parallel mode: trials in drawing order,
+        vector<unsigned> trial_nodes; // their selections ('picks' nodes per trial)
+        vector<unsigned> pending;     // and those still to be scored
+        // Scratch of update_subtree()
+        vector<unsigned> affected_nodes, old_p, old_a, Q;
+        Overlay overlay;
+        ScenarioEvaluator evaluator; // Attached by set_scenarios()
+        unsigned long long int table_lookups, table_hits;
+        Worker(unsigned n) : heap(n), budget(0), F(n), N(n), N_copy(n), table_lookups(0), table_hits(0) {}
+    };
+
+    // Child of a beam parent, scored by delta() but not applied yet. Its selection is
+    // stored in the Expansion of the parent at [first, first + count). With scenarios,
+    // prune() ranks children by their robust scores instead.
+    struct Child {
+        unsigned parent;
+        unsigned first;
+        unsigned count;
+        unsigned objv;
+        unsigned time_to_survival;
+        uint64_t fingerprint;
+        unsigned long long int robust_objv;
+        unsigned long long int robust_tts;
+    };
+
+    // Children of one beam parent
+    struct Expansion {
+        vector<Child> children;
+        vector<unsigned> nodes;
+        vector<unsigned> known; // Transposition table entries that scored trials, touched after the step
+    };
 
     // Parameters
     mt19937 _gen;
@@ -37,25 +153,56 @@ class Algorithm {
     unsigned _z;
     unsigned _zmax;
     unsigned _c;
+    bool _horizon_bounded;
+    bool _trial_parallel;        // Trials of a parent instead of parents run in parallel (see set_trial_parallel)
+    const Scenarios* _scenarios; // Robust scoring when set
+    Robust _robust;
 
     // State
     Solution _A0;
     unsigned _free_burning_time;
-    MyHeap _Heap;
+    Solution _root;        // Beam search starts from _root at level _first_level (see fix_prefix)
+    unsigned _first_level;
+    vector<Worker> _workers;
+    ThreadPool _pool;
+    Profile _profile;
+
+    // Beam of the current level: the first _beam_size entries of _beam. Solutions are kept
+    // across levels and iterations, so copying a parent into a survivor reuses its buffers.
+    vector<Solution> _beam;
+    vector<Solution> _survivors;
+    unsigned _beam_size;
+    vector<unsigned> _seeds;
+    vector<Expansion> _expansions;
+    vector<Child> _E;
+    vector<pair<unsigned long long int, unsigned>> _ranking;
+    FingerprintSet _merge_cache;
+    unique_ptr<TranspositionTable> _table; // Beam members of earlier iterations (see set_table)
+    const Deadline* _deadline;             // Polled in the trial loop and between levels
+    bool _cancelled;                       // The last beam search was stopped by the deadline or a cancellation
 
     /* ----------------- BEAM SEARCH ---------------------------- */
-    void step(Solution& sol, unsigned instant, unsigned quantity, vector<Solution>& E){
+    void step(Worker& wk, Solution& sol, unsigned parent, unsigned level, unsigned instant, unsigned quantity, Expansion& out){
         bool last_round = (_I.alpha(instant) == _I.H);
-        set<unsigned> F;
-        set<unsigned> N;
-        set<unsigned> N_copy;
-        vector<unsigned> to_remove_N;
-        vector<unsigned> to_insert_N;
-        vector<unsigned> to_insert_F;
-        vector<unsigned> selection;
-        set<string> cache;
-        vector<vector<unsigned>> candidates;
-        vector<pair<unsigned, unsigned>> scores;
+        SparseSet& F = wk.F;
+        SparseSet& N = wk.N;
+        SparseSet& N_copy = wk.N_copy;
+        vector<unsigned>& to_remove_N = wk.to_remove_N;
+        vector<unsigned>& to_insert_N = wk.to_insert_N;
+        vector<unsigned>& to_insert_F = wk.to_insert_F;
+        vector<unsigned>& selection = wk.selection;
+        FingerprintSet& cache = wk.cache;
+        vector<unsigned>& candidates = wk.candidates;
+        vector<pair<unsigned, unsigned>>& metrics = wk.metrics;
+        vector<uint64_t>& fingerprints = wk.fingerprints;
+        TopK<unsigned>& best = wk.best;
+        F.clear();
+        N.clear();
+        N_copy.clear();
+        cache.clear();
+        out.children.clear();
+        out.nodes.clear();
+        out.known.clear();
         uniform_real_distribution<double> dist01(0, 1);
 
         // Compute f(t, z)
@@ -72,35 +219,61 @@ class Algorithm {
             zp--;
         }
         fp_cutoff = 0.5 * lb + 0.5 * ub;
+        // Arrival times at or after H are only lower bounds in horizon-bounded mode
+        if(_horizon_bounded)
+            fp_cutoff = min(fp_cutoff, _I.H - 1.0);
 
-        for(const Solution& s : E)
-            cache.insert(s.has_resource); 
-        
-        // Build F
-        for(unsigned n = 0; n < _I.n; n++) 
-            if(!sol.has_resource[n] && sol.fire_path.a[n] >= instant && sol.fire_path.a[n] <= fp_cutoff)
-                F.insert(n);
-
-        // Build N
-        for(pair<unsigned, unsigned>& a :  sol.allocation){
-            for(unsigned v : _I.get_extended_neighborhood(a.first))
-                if(F.contains(v)) {
-                    N_copy.insert(v);
-                    N.insert(v);        
-                }
+        {
+            PROFILE_SCOPE(wk.profile, candidates);
+            // Build F
+            for(unsigned n = 0; n < _I.n; n++) 
+                if(!sol.has_resource[n] && sol.fire_path.a[n] >= instant && sol.fire_path.a[n] <= fp_cutoff)
+                    F.insert(n);
+
+            // Build N
+            for(pair<unsigned, unsigned>& a :  sol.allocation){
+                for(unsigned v : _I.get_extended_neighborhood(a.first))
+                    if(F.contains(v)) {
+                        N_copy.insert(v);
+                        N.insert(v);        
+                    }
+            }
+            PROFILE_COUNT(wk.profile.level(level).F += F.size());
+            PROFILE_COUNT(wk.profile.level(level).N += N.size());
         }
         
+        // Trials and the final selection of the eta best
+        PROFILE_SCOPE(wk.profile, trials);
+        // Once the fire is contained F may hold fewer nodes than there are resources
+        unsigned picks = min(quantity, F.size());
+        // Only the eta best trials are kept (the single best one in the last round)
+        unsigned keep = last_round ? 1 : _eta;
+        best.reset(keep);
+        candidates.resize(keep * picks);
+        metrics.resize(keep);
+        fingerprints.resize(keep);
+        auto offer = [&](unsigned h1, unsigned h2, uint64_t fingerprint, span<const unsigned> nodes){
+            unsigned slot = best.offer(instant >= _that || last_round ? h1 : h2);
+            if(slot != TopK<unsigned>::NONE){
+                copy(nodes.begin(), nodes.end(), candidates.begin() + slot * picks);
+                metrics[slot] = {h1, h2};
+                fingerprints[slot] = fingerprint;
+            }
+        };
+        wk.trials.clear();
+        wk.trial_nodes.clear();
+        wk.pending.clear();
         for(unsigned trial = 0; trial < _c * F.size(); trial++) {
+            if(_deadline && _deadline->expired())
+                break;
             unsigned u;
             // Expand
-            for(unsigned res = 0; res < quantity; res++){
-                if(!N.empty() && dist01(_gen) < _p){
-                    uniform_int_distribution<> distC(0, N.size()-1); 
-                    u = *next(N.begin(), distC(_gen));
+            for(unsigned res = 0; res < picks; res++){
+                if(!N.empty() && dist01(wk.gen) < _p){
+                    u = N.sample(wk.gen);
                 } else{
                     assert(!F.empty());
-                    uniform_int_distribution<> distF(0, F.size()-1); 
-                    u = *next(F.begin(), distF(_gen));
+                    u = F.sample(wk.gen);
                 }
                 selection.push_back(u); 
                 F.erase(u);
@@ -118,26 +291,37 @@ class Algorithm {
                 } 
             }
             
+            uint64_t fingerprint = sol.fingerprint;
             for(unsigned n : selection) 
-                sol.has_resource[n] = true;
+                fingerprint ^= _I.zobrist[n];
             
-            if(!cache.contains(sol.has_resource)) {
-                cache.insert(sol.has_resource);
-                auto metrics = delta(sol, selection);
-                unsigned h1 =  (sol.objv - metrics.first);
-                unsigned h2 =  (sol.time_to_survival - metrics.second);
-                if(candidates.empty() || !last_round){
-                    candidates.emplace_back(selection);
-                    if(instant >= _that || last_round)
-                        scores.emplace_back(h1, candidates.size()-1);
-                    else   
-                        scores.emplace_back(h2, candidates.size()-1);
-                }else{
-                    if(scores[0].first > h1){
-                        scores[0] = {h1, 0};
-                        candidates[0] = selection;
-                    }
+            PROFILE_COUNT(wk.profile.cache_lookups++);
+            if(!cache.insert(fingerprint)) {
+                PROFILE_COUNT(wk.profile.cache_hits++);
+            } else {
+                unsigned h1 = 0, h2 = 0;
+                unsigned known = TranspositionTable::NONE;
+                if(_table) {
+                    wk.table_lookups++;
+                    known = _table->find(level, fingerprint);
+                }
+                if(known != TranspositionTable::NONE) {
+                    wk.table_hits++;
+                    h1 = _table->get(known).objv;
+                    h2 = _table->get(known).time_to_survival;
+                    out.known.push_back(known);
+                } else if(_trial_parallel) {
+                    wk.pending.push_back(wk.trials.size());
+                } else {
+                    auto d = delta(wk, sol, selection);
+                    h1 =  (sol.objv - d.first);
+                    h2 =  (sol.time_to_survival - d.second);
                 }
+                if(_trial_parallel) {
+                    wk.trials.push_back({fingerprint, h1, h2});
+                    wk.trial_nodes.insert(wk.trial_nodes.end(), selection.begin(), selection.end());
+                } else
+                    offer(h1, h2, fingerprint, selection);
             }
 
             for(unsigned u : to_remove_N)
@@ -146,8 +330,6 @@ class Algorithm {
                 N.insert(u);
             for(unsigned u : to_insert_F)
                 F.insert(u);
-            for(unsigned n : selection) 
-                sol.has_resource[n] = false;
             
             to_remove_N.clear();
             to_insert_N.clear();
@@ -155,53 +337,155 @@ class Algorithm {
             selection.clear();
         }
 
-        sort(scores.begin(), scores.end(), [](pair< unsigned, unsigned>& a, pair<unsigned,unsigned>& b){ return a.first < b.first;});
-        for(unsigned n = 0; n < min(scores.size(), size_t(_eta)); n++) {
-            Solution a_prime = sol;
-            add_resource(a_prime, instant, candidates[scores[n].second]);
-            E.push_back(a_prime);
+        // Trial-parallel mode: the trials were drawn as above and are scored on the read-only parent
+        // by all threads; offering them in drawing order keeps the serial outcome
+        if(_trial_parallel) {
+            span<const unsigned> nodes(wk.trial_nodes);
+            _pool.parallel_for(wk.pending.size(), [&](unsigned idx, unsigned t){
+                if(_deadline && _deadline->expired())
+                    return;
+                Trial& trial = wk.trials[wk.pending[idx]];
+                auto d = delta_overlaid(_workers[t], sol, nodes.subspan(wk.pending[idx] * picks, picks));
+                trial.h1 = sol.objv - d.first;
+                trial.h2 = sol.time_to_survival - d.second;
+            });
+            for(unsigned idx = 0; idx < wk.trials.size(); idx++)
+                offer(wk.trials[idx].h1, wk.trials[idx].h2, wk.trials[idx].fingerprint, nodes.subspan(idx * picks, picks));
+        }
+
+        // Nothing left to protect: the parent moves on to the next level unchanged
+        if(best.empty())
+            out.children.push_back({parent, 0, 0, sol.objv, sol.time_to_survival, sol.fingerprint});
+        for(const auto& e : best.sorted()) {
+            unsigned idx = e.slot;
+            out.children.push_back({parent, unsigned(out.nodes.size()), picks, metrics[idx].first, metrics[idx].second, fingerprints[idx]});
+            out.nodes.insert(out.nodes.end(), candidates.begin() + idx * picks, candidates.begin() + (idx + 1) * picks);
         }
+        if(_scenarios)
+            score_children(wk, sol, out);
     }
 
-    void prune(vector<Solution>& A, vector<Solution>& E, unsigned instant){ 
-        if(instant >= _that)
-            sort(E.begin(), E.end(), [](Solution& a, Solution& b){return a.objv < b.objv;});
-        else
-            sort(E.begin(), E.end(), [](Solution& a, Solution& b){return a.time_to_survival < b.time_to_survival;});
-        A.clear();
-        for(unsigned i = 0; i < min(size_t(_beta), E.size()); i++)
-            A.emplace_back(E[i]);
+    // Trials are filtered with the nominal delta(); only the kept children are scored in every scenario
+    void score_children(Worker& wk, Solution& sol, Expansion& out){
+        PROFILE_SCOPE(wk.profile, scenarios);
+        for(Child& c : out.children) {
+            span<const unsigned> nodes = span<const unsigned>(out.nodes).subspan(c.first, c.count);
+            for(unsigned n : nodes)
+                sol.has_resource.set(n);
+            const ScenarioScore& score = wk.evaluator.evaluate(sol.has_resource);
+            c.robust_objv = score.objv(_robust);
+            c.robust_tts = score.tts(_robust);
+            for(unsigned n : nodes)
+                sol.has_resource.reset(n);
+        }
+    }
+
+    void merge(vector<Child>& E){
+        _merge_cache.clear();
+        E.clear();
+        for(unsigned parent = 0; parent < _beam_size; parent++)
+            for(const Child& c : _expansions[parent].children)
+                if(_merge_cache.insert(c.fingerprint))
+                    E.push_back(c);
+    }
+
+    // Keeps the best beta children; only those are applied to a copy of their parent, or
+    // copied from the transposition table
+    void prune(vector<Child>& E, unsigned level, unsigned instant){ 
+        PROFILE_SCOPE(_profile, prune);
+        // Partial selection over (key, position) pairs; ties keep the order of E
+        _ranking.clear();
+        for(unsigned idx = 0; idx < E.size(); idx++)
+            if(_scenarios)
+                _ranking.emplace_back(instant >= _that ? E[idx].robust_objv : E[idx].robust_tts, idx);
+            else
+                _ranking.emplace_back(instant >= _that ? E[idx].objv : E[idx].time_to_survival, idx);
+        unsigned size = min(size_t(_beta), E.size());
+        partial_sort(_ranking.begin(), _ranking.begin() + size, _ranking.end());
+        while(_survivors.size() < size)
+            _survivors.emplace_back(_I);
+        _pool.parallel_for(size, [&](unsigned idx, unsigned t){
+            const Child& c = E[_ranking[idx].second];
+            span<const unsigned> nodes = span<const unsigned>(_expansions[c.parent].nodes).subspan(c.first, c.count);
+            unsigned known = _table ? _table->find(level, c.fingerprint) : TranspositionTable::NONE;
+            if(known != TranspositionTable::NONE) {
+                // Only the fire path is taken over; the allocation stays the one of this path, whose order step() samples from
+                _survivors[idx] = _table->get(known);
+                _survivors[idx].allocation = _beam[c.parent].allocation;
+                for(unsigned n : nodes)
+                    _survivors[idx].allocation.emplace_back(n, instant);
+            } else {
+                _survivors[idx] = _beam[c.parent];
+                add_resource(_workers[t], _survivors[idx], instant, nodes);
+            }
+            assert(_survivors[idx].objv == c.objv && _survivors[idx].time_to_survival == c.time_to_survival);
+        });
+        _beam.swap(_survivors);
+        _beam_size = size;
+        if(_table) {
+            _table->stats.survivors += size;
+            for(unsigned idx = 0; idx < size; idx++) {
+                _table->stats.reused += _table->find(level, _beam[idx].fingerprint) != TranspositionTable::NONE;
+                _table->insert(level, _beam[idx]);
+            }
+        }
     }
  
      /* ----------------- SPT OPERATIONS ------------------------- */
-    void add_resource(Solution& sol, unsigned instant, vector<unsigned>& nodes){
-        vector<unsigned> affected_nodes, old_a, old_p;
+    void add_resource(Worker& wk, Solution& sol, unsigned instant, span<const unsigned> nodes){
+        PROFILE_SCOPE(wk.profile, add_resource);
         for (auto n : nodes) {
-            sol.has_resource[n] = true;
+            sol.has_resource.set(n);
+            sol.fingerprint ^= _I.zobrist[n];
             sol.allocation.emplace_back(n, instant);
         }
-        update_subtree(sol, nodes, affected_nodes, old_p, old_a);
-        update_solution(sol, affected_nodes, nodes, old_a);
+        InPlace view{sol.fire_path, sol.has_resource};
+        update_subtree(wk, view, nodes, wk.affected_nodes, wk.old_p, wk.old_a);
+        update_solution(sol, wk.affected_nodes, wk.old_a);
     }
     
-    pair<unsigned, unsigned> delta(Solution& sol, vector<unsigned>& selection){
+    pair<unsigned, unsigned> delta(Worker& wk, Solution& sol, span<const unsigned> selection){
+        PROFILE_SCOPE(wk.profile, delta);
+        vector<unsigned>& affected_nodes = wk.affected_nodes;
+        vector<unsigned>& old_p = wk.old_p;
+        vector<unsigned>& old_a = wk.old_a;
+        for(auto n : selection) 
+            sol.has_resource.set(n);
+        InPlace view{sol.fire_path, sol.has_resource};
+        update_subtree(wk, view, selection, affected_nodes, old_p, old_a);
+        auto d = gain(view, affected_nodes, old_a);
+        for(auto n : selection) 
+            sol.has_resource.reset(n);
+        undo_update(sol, affected_nodes, old_p, old_a);
+
+        return d;
+    }
+
+    // delta() without modifying 'sol': the changes go to the worker's overlay, so several
+    // threads can score trials of the same parent
+    pair<unsigned, unsigned> delta_overlaid(Worker& wk, const Solution& sol, span<const unsigned> selection){
+        PROFILE_SCOPE(wk.profile, delta);
+        Overlay& ov = wk.overlay;
+        ov.begin(_I.n);
+        for(auto n : selection)
+            ov.resource[n] = ov.epoch;
+        Overlaid view{sol.fire_path, sol.has_resource, ov};
+        update_subtree(wk, view, selection, wk.affected_nodes, wk.old_p, wk.old_a);
+        return gain(view, wk.affected_nodes, wk.old_a);
+    }
+
+    // Burned nodes and time to survival saved by an update, from the old arrival times of the affected nodes
+    template<class View>
+    pair<unsigned, unsigned> gain(const View& view, const vector<unsigned>& affected_nodes, const vector<unsigned>& old_a){
         unsigned objv_delta = 0;
         unsigned tts_delta = 0;
-        vector<unsigned> affected_nodes, old_p, old_a;
-        for(auto n : selection) 
-            sol.has_resource[n] = true;
-        update_subtree(sol, selection, affected_nodes, old_p, old_a);
         for(unsigned idx_u = 0;  idx_u < affected_nodes.size(); idx_u++){
             unsigned u = affected_nodes[idx_u];
-            if (old_a[idx_u] < _I.H && sol.fire_path.a[u] >= _I.H)
+            if (old_a[idx_u] < _I.H && view.a(u) >= _I.H)
                 objv_delta++;
             if (old_a[idx_u] < _I.H)
-                tts_delta += (min(sol.fire_path.a[u], _I.H) - old_a[idx_u]);
+                tts_delta += (min(view.a(u), _I.H) - old_a[idx_u]);
         }
-        for(auto n : selection) 
-            sol.has_resource[n] = false;
-        undo_update(sol, affected_nodes, old_p, old_a);
-
         return {objv_delta, tts_delta};
     }
 
@@ -214,74 +498,96 @@ class Algorithm {
         }
     }
 
-    void update_subtree(Solution& sol, const vector<unsigned>& sources, vector<unsigned>& affected_nodes, vector<unsigned>& old_p, vector<unsigned>& old_a){
+    // In horizon-bounded mode nothing is propagated from nodes reached at or after H: their
+    // arrival times become lower bounds that are still >= H, which is all objv and
+    // time_to_survival depend on. complete_fire_path() makes them exact again.
+    template<class View>
+    void update_subtree(Worker& wk, View& view, span<const unsigned> sources, vector<unsigned>& affected_nodes, vector<unsigned>& old_p, vector<unsigned>& old_a){
+        PROFILE_SCOPE(wk.profile, update_subtree);
         // Update budget counter
-        _budget++;
-        _Heap.clear();
-        ShortestPathTree& spt = sol.fire_path;
-        vector<unsigned> Q;
+        wk.budget++;
+        Heap& heap = wk.heap;
+        heap.clear();
+        unsigned bound = _horizon_bounded ? _I.H : INF;
+        vector<unsigned>& Q = wk.Q;
+        Q.clear();
         affected_nodes.clear();
+        old_p.clear();
+        old_a.clear();
         for(unsigned  s : sources){
-            for(Edge *e : _I.get_outgoing_edges(s)){
-                unsigned u = e->destination;
-                if(spt.p[e->destination] == s)
-                    _Heap.insertElement(u, spt.a[u]);
+            for(const Arc& e : _I.get_outgoing_arcs(s)){
+                unsigned u = e.node;
+                if(view.p(u) == s && view.a(u) < bound)
+                    heap.insertElement(u, view.a(u));
             }
         }
-        while(!_Heap.empty()){
-            unsigned u = _Heap.findAndDeleteMinElement();
-            unsigned pred_u = spt.p[u];
-            for(Edge* e : _I.get_incoming_edges(u)){
-                unsigned v = e->source;
-                unsigned w = sol.has_resource[v] ? e->weight + _I.Delta : e->weight;
-                if(spt.a[u] == spt.a[v] + w){
+        while(!heap.empty()){
+            unsigned u = heap.findAndDeleteMinElement();
+            unsigned pred_u = view.p(u);
+            // A node that also ignites by itself at its arrival time keeps it as a root
+            if(_I.ignition_time[u] == view.a(u)){
+                affected_nodes.push_back(u);
+                old_p.push_back(view.p(u));
+                old_a.push_back(view.a(u));
+                view.set_p(u, u);
+            }
+            else for(const Arc& e : _I.get_incoming_arcs(u)){
+                unsigned v = e.node;
+                unsigned w = view.resource(v) ? e.weight + _I.Delta : e.weight;
+                if(view.a(u) == view.a(v) + w){
                     affected_nodes.push_back(u);
-                    old_p.push_back(spt.p[u]);
-                    old_a.push_back(spt.a[u]);
-                    spt.p[u] = v;
+                    old_p.push_back(view.p(u));
+                    old_a.push_back(view.a(u));
+                    view.set_p(u, v);
                     break;
                 }
             }
-            if(pred_u == spt.p[u]){
+            if(pred_u == view.p(u)){
                 affected_nodes.push_back(u);
-                old_p.push_back(spt.p[u]);
-                old_a.push_back(spt.a[u]);
+                old_p.push_back(view.p(u));
+                old_a.push_back(view.a(u));
                 Q.push_back(u);
-                spt.a[u] = INF;
-                for(Edge* e : _I.get_outgoing_edges(u)){
-                    unsigned v = e->destination;
-                    if(spt.p[v] == u && spt.a[v] != INF)
-                        _Heap.adjustHeap(v, spt.a[v]);
+                view.set_a(u, INF);
+                for(const Arc& e : _I.get_outgoing_arcs(u)){
+                    unsigned v = e.node;
+                    if(view.p(v) == u && view.a(v) < bound)
+                        heap.adjustHeap(v, view.a(v));
                 }
             }            
         }
         for(unsigned u : Q){
-            for(Edge* e : _I.get_incoming_edges(u)){
-                unsigned v = e->source;
-                unsigned w = sol.has_resource[v] ? e->weight + _I.Delta : e->weight;
-                if(spt.a[u] > spt.a[v] + w){
-                    spt.a[u] = spt.a[v] + w;
-                    spt.p[u] = v;
+            if(_I.ignition_time[u] < view.a(u)){
+                view.set_a(u, _I.ignition_time[u]);
+                view.set_p(u, u);
+            }
+            for(const Arc& e : _I.get_incoming_arcs(u)){
+                unsigned v = e.node;
+                unsigned w = view.resource(v) ? e.weight + _I.Delta : e.weight;
+                if(view.a(u) > view.a(v) + w){
+                    view.set_a(u, view.a(v) + w);
+                    view.set_p(u, v);
                 }
             }
-            if(spt.a[u] != INF)
-                _Heap.adjustHeap(u, spt.a[u]);
+            if(view.a(u) < bound)
+                heap.adjustHeap(u, view.a(u));
         }
-        while(!_Heap.empty()){
-            unsigned u = _Heap.findAndDeleteMinElement();
-            for(Edge* e : _I.get_outgoing_edges(u)){
-                unsigned v = e->destination;
-                unsigned w = sol.has_resource[u] ? e->weight + _I.Delta : e->weight;
-                if(spt.a[v] > spt.a[u] + w){
-                    spt.a[v] = spt.a[u] + w;
-                    spt.p[v] = u;
-                    _Heap.adjustHeap(v, spt.a[v]);
+        while(!heap.empty()){
+            unsigned u = heap.findAndDeleteMinElement();
+            for(const Arc& e : _I.get_outgoing_arcs(u)){
+                unsigned v = e.node;
+                unsigned w = view.resource(u) ? e.weight + _I.Delta : e.weight;
+                if(view.a(v) > view.a(u) + w){
+                    view.set_a(v, view.a(u) + w);
+                    view.set_p(v, u);
+                    if(view.a(v) < bound)
+                        heap.adjustHeap(v, view.a(v));
                 }
             }
         }
+        PROFILE_COUNT(wk.profile.add_affected(affected_nodes.size()));
     } 
 
-    void update_solution(Solution& sol, vector<unsigned>& affected_nodes, vector<unsigned>& selected_candidates, vector<unsigned>& old_a) {
+    void update_solution(Solution& sol, vector<unsigned>& affected_nodes, vector<unsigned>& old_a) {
         for(unsigned idx_u = 0; idx_u < affected_nodes.size(); idx_u++){
             unsigned u = affected_nodes[idx_u];
             if(sol.fire_path.a[u] >= _I.H && old_a[idx_u] < _I.H)
@@ -295,27 +601,30 @@ class Algorithm {
 
     /* ----------------- INITIALIZATION ------------------------- */  
     void build_A0(Solution& sol){
-        _Heap.clear();
+        Heap& heap = _workers[0].heap;
+        heap.clear();
         fill(sol.fire_path.a.begin(), sol.fire_path.a.end(), INF);
-        _Heap.insertElement(_I.ign, 0);
-        sol.fire_path.a[_I.ign] = 0;
-        sol.fire_path.p[_I.ign] = _I.ign;
+        for(unsigned ign : _I.ignitions){
+            heap.insertElement(ign, _I.ignition_time[ign]);
+            sol.fire_path.a[ign] = _I.ignition_time[ign];
+            sol.fire_path.p[ign] = ign;
+        }
         sol.objv = 0;
         sol.time_to_survival = 0;
         _free_burning_time = 0;
-        while (!_Heap.empty()) {
-            unsigned u = _Heap.findAndDeleteMinElement();
+        while (!heap.empty()) {
+            unsigned u = heap.findAndDeleteMinElement();
             unsigned du = sol.fire_path.a[u];
             if (_I.H > du){
               sol.objv++;
               sol.time_to_survival += max(_I.H - du, 0u);
               _free_burning_time = max(_free_burning_time, du);
             }
-            for (Edge *e : _I.get_outgoing_edges(u)) {
-                unsigned v = e->destination;
-                unsigned w = e->weight;
+            for(const Arc& e : _I.get_outgoing_arcs(u)) {
+                unsigned v = e.node;
+                unsigned w = e.weight;
                 if (sol.fire_path.a[v] > du + w && u != v) {
-                    _Heap.adjustHeap(v, du + w);
+                    heap.adjustHeap(v, du + w);
                     sol.fire_path.a[v] = du + w;
                     sol.fire_path.p[v] = u;
                 }
@@ -325,7 +634,14 @@ class Algorithm {
     /* ---------------------------------------------------------- */  
 
 public:
-    Algorithm(Instance &__I, unsigned __seed,  double __p,  double __phat,  unsigned __beta, unsigned __eta, unsigned __zmax, unsigned __c) : _budget(0),
+    // Everything that carries over from one iteration to the next; the rest is rebuilt from the instance
+    struct State {
+        mt19937 gen;
+        unsigned z;
+        unsigned long long int budget;
+    };
+
+    Algorithm(Instance &__I, unsigned __seed,  double __p,  double __phat,  unsigned __beta, unsigned __eta, unsigned __zmax, unsigned __c, unsigned __threads = 1, bool __horizon_bounded = false) : 
                                                                                                                           _gen(mt19937(__seed)), 
                                                                                                                           _I(__I), 
                                                                                                                           _seed(__seed),
@@ -337,26 +653,228 @@ public:
                                                                                                                           _z(0),
                                                                                                                           _zmax(__zmax),
                                                                                                                           _c(__c),
+                                                                                                                          _horizon_bounded(__horizon_bounded),
+                                                                                                                          _trial_parallel(false),
+                                                                                                                          _scenarios(nullptr),
+                                                                                                                          _robust(Robust::EXPECTED),
                                                                                                                           _A0(__I),
-                                                                                                                          _Heap(__I.n){
+                                                                                                                          _root(__I),
+                                                                                                                          _first_level(0),
+                                                                                                                          _workers(max(__threads, 1u), Worker(__I.n)),
+                                                                                                                          _pool(__threads),
+                                                                                                                          _beam_size(0),
+                                                                                                                          _deadline(nullptr),
+                                                                                                                          _cancelled(false){
         build_A0(_A0);
+        _root = _A0;
         _that = _phat * _free_burning_time;
     }
 
-    Solution beam_search(unsigned bkv) {
-        vector<Solution> A = {_A0};
-        for(const auto& [instant, quantity] : _I.R) {
-            vector<Solution> E;
-            for(Solution& s : A)
-                step(s, instant, quantity, E);
-            prune(A, E, instant);
+    // The returned solution stays valid until the next call. If the deadline expires or is cancelled,
+    // the search stops and returns the best member of the last completed level (see cancelled()).
+    const Solution& beam_search(unsigned bkv) {
+        if(_beam.empty())
+            _beam.emplace_back(_I);
+        _beam[0] = _root;
+        _beam_size = 1;
+        _cancelled = false;
+        for(unsigned level = _first_level; level < _I.R.size(); level++) {
+            if(_deadline && _deadline->expired()) {
+                _cancelled = true;
+                break;
+            }
+            auto [instant, quantity] = _I.R[level];
+            // Each parent gets its own random stream, so the outcome does not depend on the number of threads
+            _seeds.resize(_beam_size);
+            for(unsigned& seed : _seeds)
+                seed = _gen();
+            if(_expansions.size() < _beam_size)
+                _expansions.resize(_beam_size);
+            auto expand = [&](unsigned idx, unsigned t){
+                Worker& wk = _workers[t];
+                wk.gen.seed(_seeds[idx]);
+                step(wk, _beam[idx], idx, level, instant, quantity, _expansions[idx]);
+            };
+            // In trial-parallel mode step() spreads the trials of each parent over the threads instead
+            if(_trial_parallel)
+                for(unsigned idx = 0; idx < _beam_size; idx++)
+                    expand(idx, 0);
+            else
+                _pool.parallel_for(_beam_size, expand);
+            // A level whose trials were cut short is dropped
+            if(_deadline && _deadline->expired()) {
+                _cancelled = true;
+                break;
+            }
+            // In parent order, so evictions do not depend on the number of threads
+            if(_table)
+                for(unsigned idx = 0; idx < _beam_size; idx++)
+                    for(unsigned known : _expansions[idx].known)
+                        _table->touch(known);
+            merge(_E);
+            PROFILE_COUNT(_profile.level(level).parents += _beam_size);
+            PROFILE_COUNT(_profile.level(level).children += _E.size());
+            prune(_E, level, instant);
         }
-        if(A[0].objv >= bkv)
+        if(!_cancelled && score(_beam[0]) >= bkv)
             _z = (_z+1) % _zmax;
-        return A[0]; 
+        return _beam[0]; 
+    }
+
+    // The deadline must outlive the algorithm; nullptr removes it
+    void set_deadline(const Deadline* deadline){ _deadline = deadline; }
+
+    inline bool cancelled() const { return _cancelled; }
+
+    // Resizes the search for the next iterations (see ParameterController)
+    void set_parameters(unsigned beta, unsigned eta, unsigned c){
+        _beta = max(beta, 1u);
+        _eta = max(eta, 1u);
+        _c = max(c, 1u);
+    }
+
+    // Ranks children by their burned nodes over 'scenarios' (expected or worst case) instead of
+    // the nominal ones; the scenarios must outlive the algorithm
+    void set_scenarios(const Scenarios* scenarios, Robust robust){
+        _scenarios = scenarios;
+        _robust = robust;
+        for(Worker& w : _workers)
+            w.evaluator.attach(_I, scenarios);
+    }
+
+    // Value compared with the incumbent: the objective value, or its robust counterpart with scenarios
+    unsigned score(const Solution& sol){
+        if(!_scenarios)
+            return sol.objv;
+        return _workers[0].evaluator.evaluate(sol.has_resource).objv(_robust);
+    }
+
+    // Runs the trials of one parent in parallel instead of the parents of a level, which keeps
+    // the threads busy when the beam is narrow and each parent has many trials. The outcome is
+    // the same either way.
+    void set_trial_parallel(bool trial_parallel){ _trial_parallel = trial_parallel; }
+
+    // Keeps beam members across iterations in a transposition table of about 'bytes' bytes (0 disables it)
+    void set_table(size_t bytes){
+        _table = bytes > 0 ? make_unique<TranspositionTable>(bytes) : nullptr;
+    }
+
+    TranspositionTable::Stats get_table_stats(){
+        TranspositionTable::Stats stats;
+        if(!_table)
+            return stats;
+        stats = _table->stats;
+        stats.entries = _table->size();
+        stats.bytes = _table->memory();
+        for(const Worker& w : _workers) {
+            stats.lookups += w.table_lookups;
+            stats.hits += w.table_hits;
+        }
+        return stats;
     }
 
     void reset_random_state(){ _gen = mt19937(_seed); }
 
-    inline unsigned long long int get_budget(){ return _budget;}
+    // Starts a new run on the same instance, keeping A0 and the grown scratch buffers
+    void reset(unsigned seed){
+        _seed = seed;
+        _gen = mt19937(seed);
+        _z = 0;
+        for(Worker& w : _workers)
+            w.budget = 0;
+        _root = _A0;
+        _first_level = 0;
+    }
+
+    State get_state(){ return {_gen, _z, get_budget()}; }
+
+    void set_state(const State& state){
+        _gen = state.gen;
+        _z = state.z;
+        for(Worker& w : _workers)
+            w.budget = 0;
+        _workers[0].budget = state.budget;
+    }
+
+    // Warm start: the resources of the first 'levels' instants are fixed to those of 'allocation'
+    // and beam search only decides the remaining ones. Returns the root of the search.
+    const Solution& fix_prefix(const vector<pair<unsigned, unsigned>>& allocation, unsigned levels){
+        vector<pair<unsigned, unsigned>> prefix;
+        for(const auto& a : allocation)
+            if(levels == _I.R.size() || a.second < _I.R[levels].first)
+                prefix.push_back(a);
+        replay(_root, prefix);
+        _first_level = levels;
+        return _root;
+    }
+
+    // Rebuilds a solution found by this search from its allocation. The resources of each
+    // instant are added in the same order and with the same updates as during the search,
+    // so the fire path comes out identical.
+    void replay(Solution& sol, const vector<pair<unsigned, unsigned>>& allocation){
+        sol = _A0;
+        vector<unsigned> nodes;
+        for(unsigned idx = 0; idx < allocation.size(); idx++){
+            nodes.push_back(allocation[idx].first);
+            if(idx + 1 == allocation.size() || allocation[idx + 1].second != allocation[idx].second){
+                add_resource(_workers[0], sol, allocation[idx].second, nodes);
+                nodes.clear();
+            }
+        }
+    }
+
+    // Recomputes the arrival times left as lower bounds by horizon-bounded updates. Nodes
+    // reached before H are already exact and seed the search with their current tree.
+    void complete_fire_path(Solution& sol){
+        if(!_horizon_bounded)
+            return;
+        Heap& heap = _workers[0].heap;
+        heap.clear();
+        ShortestPathTree& spt = sol.fire_path;
+        for(unsigned u = 0; u < _I.n; u++) {
+            if(spt.a[u] < _I.H)
+                heap.insertElement(u, spt.a[u]);
+            else if(_I.ignition_time[u] != NO_IGNITION){
+                // Ignitions at or after H are roots again
+                spt.a[u] = _I.ignition_time[u];
+                spt.p[u] = u;
+                heap.insertElement(u, spt.a[u]);
+            }
+            else
+                spt.a[u] = INF;
+        }
+        while(!heap.empty()){
+            unsigned u = heap.findAndDeleteMinElement();
+            for(const Arc& e : _I.get_outgoing_arcs(u)){
+                unsigned v = e.node;
+                unsigned w = sol.has_resource[u] ? e.weight + _I.Delta : e.weight;
+                if(spt.a[v] > spt.a[u] + w){
+                    spt.a[v] = spt.a[u] + w;
+                    spt.p[v] = u;
+                    heap.adjustHeap(v, spt.a[v]);
+                }
+            }
+        }
+    }
+
+    // Instrumentation gathered by all workers; empty unless compiled with PROFILE
+    Profile get_profile(){
+        Profile profile = _profile;
+        for(const Worker& w : _workers) {
+            profile.merge(w.profile);
+#ifdef PROFILE
+            profile.heap_pushes += w.heap.pushes;
+            profile.heap_updates += w.heap.updates;
+            profile.heap_pops += w.heap.pops;
+#endif
+        }
+        return profile;
+    }
+
+    inline unsigned long long int get_budget(){ 
+        unsigned long long int budget = 0;
+        for(const Worker& w : _workers)
+            budget += w.budget;
+        return budget;
+    }
 };
\ No newline at end of file
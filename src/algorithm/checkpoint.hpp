@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+#include "algorithm.hpp"
+#include "incumbent.hpp"
+
+/*
+    Snapshot of an iterated search taken between iterations. The incumbent is
+    stored as its allocation only and rebuilt with Algorithm::replay(); the
+    random state, z, budget and parameter scale (--target-iters) of each
+    search of the portfolio are stored as-is, so a resumed single search
+    continues exactly where it stopped.
+    'parameters' holds the options the run was started with, so a checkpoint
+    is not resumed with a different configuration.
+*/
+struct Checkpoint {
+    json parameters;
+    unsigned iterations = 0;
+    unsigned long long int elapsed_ms = 0;
+    vector<Algorithm::State> searches;
+    vector<double> scales;  // Factor of each search's ParameterController
+    bool has_incumbent = false;
+    unsigned objv = 0, timestamp = 0, iter = 0;
+    vector<pair<unsigned, unsigned>> allocation;
+    Trajectory trajectory;
+
+    // Writes to a temporary file first, so a run killed while writing keeps the previous checkpoint
+    void write(const string& file) const {
+        json data;
+        data["parameters"] = parameters;
+        data["iterations"] = iterations;
+        data["elapsed_ms"] = elapsed_ms;
+        data["searches"] = json::array();
+        for (unsigned k = 0; k < searches.size(); k++) {
+            ostringstream gen;
+            gen << searches[k].gen;
+            data["searches"].push_back({{"gen", gen.str()}, {"z", searches[k].z}, {"budget", searches[k].budget}, {"scale", scales[k]}});
+        }
+        if (has_incumbent)
+            data["incumbent"] = {{"objv", objv}, {"timestamp", timestamp}, {"iter", iter}, {"allocation", allocation}};
+        data["trajectory"] = json::array();
+        for (const auto& [obj, et, it, b] : trajectory)
+            data["trajectory"].push_back({obj, et, it, b});
+
+        string tmp = file + ".tmp";
+        ofstream out(tmp);
+        out << data.dump() << endl;
+        out.close();
+        if (!out.good() || rename(tmp.c_str(), file.c_str()) != 0) {
+            cerr << "Could not write checkpoint: " << file << endl;
+            exit(1);
+        }
+    }
+
+    void read(const string& file) {
+        ifstream f(file);
+        if (!f.good()) {
+            cerr << "Could not open file: '" << file << "'" << endl;
+            exit(1);
+        }
+        json data = json::parse(f);
+        parameters = data["parameters"];
+        iterations = data["iterations"].get<unsigned>();
+        elapsed_ms = data["elapsed_ms"].get<unsigned long long int>();
+        searches.clear();
+        scales.clear();
+        for (auto& entry : data["searches"]) {
+            Algorithm::State s;
+            istringstream(entry["gen"].get<string>()) >> s.gen;
+            s.z = entry["z"].get<unsigned>();
+            s.budget = entry["budget"].get<unsigned long long int>();
+            searches.push_back(s);
+            scales.push_back(entry.value("scale", 1.0));
+        }
+        has_incumbent = data.contains("incumbent");
+        if (has_incumbent) {
+            objv = data["incumbent"]["objv"].get<unsigned>();
+            timestamp = data["incumbent"]["timestamp"].get<unsigned>();
+            iter = data["incumbent"]["iter"].get<unsigned>();
+            allocation = data["incumbent"]["allocation"].get<vector<pair<unsigned, unsigned>>>();
+        }
+        trajectory.clear();
+        for (auto& entry : data["trajectory"])
+            trajectory.emplace_back(entry[0].get<unsigned>(), entry[1].get<unsigned>(), entry[2].get<unsigned>(),
+                                    entry[3].get<unsigned long long int>());
+    }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+/*
+    Sizes the beam search so that a requested number of iterations fits into
+    the time that is left. The cost of an iteration grows with beta * c
+    (parents times trials per candidate), so beta, eta and c are all scaled by
+    a common factor f and the cost by about f^2. After every iteration, f is
+    multiplied by the square root of (time per remaining iteration / time of
+    the last iteration). The cost changes by at most a factor of 2 per
+    iteration, so one slow iteration does not collapse the search. f never
+    exceeds 'max_scale', and no parameter drops below 1.
+*/
+class ParameterController {
+   private:
+    unsigned _beta, _eta, _c;
+    double _scale, _max_scale;
+
+   public:
+    ParameterController(unsigned beta, unsigned eta, unsigned c, double max_scale = 4)
+        : _beta(beta), _eta(eta), _c(c), _scale(1), _max_scale(max_scale) {}
+
+    // 'last' is the time of the last iteration; 'wanted' the time each remaining one may take
+    void update(double last, double wanted) {
+        if (last <= 0 || wanted <= 0)
+            return;
+        double min_scale = 1.0 / max({_beta, _eta, _c});
+        _scale = clamp(_scale * sqrt(clamp(wanted / last, 0.5, 2.0)), min_scale, _max_scale);
+    }
+
+    // The common factor, saved in checkpoints
+    inline double scale() const { return _scale; }
+
+    void set_scale(double scale) { _scale = clamp(scale, 1.0 / max({_beta, _eta, _c}), _max_scale); }
+
+    inline unsigned beta() const { return max(1u, unsigned(lround(_beta * _scale))); }
+    inline unsigned eta() const { return max(1u, unsigned(lround(_eta * _scale))); }
+    inline unsigned c() const { return max(1u, unsigned(lround(_c * _scale))); }
+};
@@ -7,6 +7,8 @@ using namespace std;
 #include <boost/heap/binomial_heap.hpp>
 using namespace boost::heap;
 
+#include "profiler.hpp"
+
 class MyHeap {
 private:
     typedef struct HeapNode {
@@ -23,6 +25,10 @@ private:
     vector<binomial_heap<HeapNode, compare<CompareHeapNode>>::handle_type> handles;
     vector<bool> valid_handle;
 public:
+#ifdef PROFILE
+    unsigned long long int pushes = 0, updates = 0, pops = 0;
+#endif
+
     MyHeap(unsigned n){
         Q = binomial_heap<HeapNode, compare<CompareHeapNode>>();
         handles = vector<binomial_heap<HeapNode, compare<CompareHeapNode>>::handle_type>(n);
@@ -39,6 +45,7 @@ public:
     }
 
     unsigned findAndDeleteMinElement() {
+        PROFILE_COUNT(pops++);
         unsigned e = Q.top().n;
         Q.pop();
         valid_handle[e] = false;
@@ -51,20 +58,24 @@ public:
     }
 
     inline void deleteMin() {
+        PROFILE_COUNT(pops++);
         unsigned e = Q.top().n;
         valid_handle[e] = false;
         Q.pop();
     }
 
     void insertElement(unsigned element, unsigned key){
+        PROFILE_COUNT(pushes++);
         handles[element] = Q.push(HeapNode(element, key));
         valid_handle[element] = true;
     }
 
     void adjustHeap(unsigned element, unsigned key){
-        if (valid_handle[element]) 
+        if (valid_handle[element]) {
+            PROFILE_COUNT(updates++);
             Q.update(handles[element], HeapNode(element, key));
-        else {
+        } else {
+            PROFILE_COUNT(pushes++);
             handles[element] = Q.push(HeapNode(element, key));
             valid_handle[element] = true;
         }
@@ -80,3 +91,123 @@ public:
         cout << endl;
     }
 };
+
+// Dial's bucket queue for small non-negative integer keys. Decrease-key pushes
+// a new entry and leaves the old one behind; stale entries are skipped on pop.
+// Memory grows with the largest key, which is bounded by the fire arrival times.
+class BucketHeap {
+private:
+    vector<vector<unsigned>> buckets;
+    vector<unsigned> used_buckets;
+    vector<unsigned> key;
+    vector<bool> in_heap;
+    unsigned cursor;
+    unsigned count;
+
+    void push(unsigned element, unsigned k){
+        if (k >= buckets.size())
+            buckets.resize(k + 1);
+        if (buckets[k].empty())
+            used_buckets.push_back(k);
+        buckets[k].push_back(element);
+        cursor = min(cursor, k);
+    }
+
+    // Moves the cursor to the bucket holding the minimum and drops stale entries on the way
+    void settle(){
+        while (true) {
+            vector<unsigned>& b = buckets[cursor];
+            while (!b.empty()) {
+                unsigned e = b.back();
+                if (in_heap[e] && key[e] == cursor)
+                    return;
+                b.pop_back();
+            }
+            cursor++;
+        }
+    }
+
+public:
+#ifdef PROFILE
+    unsigned long long int pushes = 0, updates = 0, pops = 0;
+#endif
+
+    BucketHeap(unsigned n){
+        key = vector<unsigned>(n);
+        in_heap = vector<bool>(n, false);
+        cursor = 0;
+        count = 0;
+    }
+
+    void clear() {
+        for (unsigned k : used_buckets) {
+            for (unsigned e : buckets[k])
+                in_heap[e] = false;
+            buckets[k].clear();
+        }
+        used_buckets.clear();
+        cursor = 0;
+        count = 0;
+    }
+
+    inline unsigned getMinElement(){
+        settle();
+        return buckets[cursor].back();
+    }
+
+    unsigned findAndDeleteMinElement() {
+        PROFILE_COUNT(pops++);
+        settle();
+        unsigned e = buckets[cursor].back();
+        buckets[cursor].pop_back();
+        in_heap[e] = false;
+        count--;
+        return e;
+    }
+
+    pair<unsigned, unsigned> getMin(){
+        settle();
+        return {buckets[cursor].back(), cursor};
+    }
+
+    inline void deleteMin() {
+        findAndDeleteMinElement();
+    }
+
+    void insertElement(unsigned element, unsigned k){
+        PROFILE_COUNT(pushes++);
+        key[element] = k;
+        in_heap[element] = true;
+        count++;
+        push(element, k);
+    }
+
+    void adjustHeap(unsigned element, unsigned k){
+        if (!in_heap[element])
+            insertElement(element, k);
+        else if (key[element] != k) {
+            PROFILE_COUNT(updates++);
+            key[element] = k;
+            push(element, k);
+        }
+    }
+
+    inline bool empty(){
+        return count == 0;
+    }
+
+    void print_heap() {
+        for (unsigned k = cursor; k < buckets.size(); k++)
+            for (unsigned e : buckets[k])
+                if (in_heap[e] && key[e] == k)
+                    cout << "(" << k << ", " << e << ") | ";
+        cout << endl;
+    }
+};
+
+// Priority queue used by the shortest-path routines, selected at compile time
+#ifdef BUCKET_HEAP
+typedef BucketHeap Heap;
+#else
+typedef MyHeap Heap;
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <tuple>
+#include <vector>
+using namespace std;
+
+#include "solution.hpp"
+
+// (score, elapsed time, iteration, budget) of each improvement
+typedef vector<tuple<unsigned, unsigned, unsigned, unsigned long long int>> Trajectory;
+
+// Best-known solution shared by the searches of a portfolio. Solutions are
+// compared by a score: their objective value, or a robust one computed over
+// scenarios (see Algorithm::score). The score of the incumbent is readable
+// without locking, so every beam search can prune against it.
+class Incumbent {
+   private:
+    mutex _m;
+    atomic<unsigned> _bkv;
+    unsigned _best_score;
+    Solution _best;
+    Trajectory _trajectory;
+
+   public:
+    Incumbent(Instance& I) : _bkv(numeric_limits<unsigned>::max()), _best_score(numeric_limits<unsigned>::max()), _best(I) {}
+
+    inline unsigned bkv() { return _bkv.load(memory_order_relaxed); }
+
+    // Stores 'sol' if its score improves on the incumbent and returns true in that case
+    bool update(const Solution& sol, unsigned score, unsigned elapsed_time, unsigned iter, unsigned long long int budget) {
+        if (score >= bkv())
+            return false;
+        lock_guard<mutex> lock(_m);
+        if (score >= _best_score)
+            return false;
+        _best = sol;
+        _best_score = score;
+        _best.timestamp = elapsed_time;
+        _best.iter = iter;
+        _trajectory.emplace_back(score, elapsed_time, iter, budget);
+        _bkv.store(score, memory_order_relaxed);
+        return true;
+    }
+
+    bool update(const Solution& sol, unsigned elapsed_time, unsigned iter, unsigned long long int budget) {
+        return update(sol, sol.objv, elapsed_time, iter, budget);
+    }
+
+    // Only safe once the searches have stopped
+    Solution& best() { return _best; }
+
+    // Score of best(); the objective value unless solutions are scored over scenarios
+    unsigned best_score() { return _best_score; }
+
+    const Trajectory& trajectory() { return _trajectory; }
+
+    // Consistent copy of the incumbent while the searches are running
+    void snapshot(Solution& sol, Trajectory& trajectory) {
+        lock_guard<mutex> lock(_m);
+        sol = _best;
+        trajectory = _trajectory;
+    }
+
+    // Restores an incumbent saved by snapshot(); must be called before the searches start
+    void restore(const Solution& sol, unsigned score, const Trajectory& trajectory) {
+        _best = sol;
+        _best_score = score;
+        _trajectory = trajectory;
+        _bkv.store(score, memory_order_relaxed);
+    }
+};
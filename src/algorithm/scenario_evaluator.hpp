@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+using namespace std;
+
+#include "instance.hpp"
+#include "scenarios.hpp"
+#include "heap.hpp"
+#include "bitset.hpp"
+
+// How the scores of the scenarios are combined
+enum class Robust { EXPECTED, WORST };
+
+// Burned nodes and time to survival of one allocation in every scenario. Sums are
+// kept exact; objv() and tts() report expected values as means rounded to the
+// nearest integer, in the units of a single scenario.
+struct ScenarioScore {
+    vector<unsigned> burned;
+    vector<unsigned long long int> time_to_survival;
+    unsigned long long int burned_sum, tts_sum;
+    unsigned burned_worst;
+    unsigned long long int tts_worst;
+
+    inline unsigned long long int objv(Robust robust) const { return robust == Robust::EXPECTED ? mean(burned_sum) : burned_worst; }
+    inline unsigned long long int tts(Robust robust) const { return robust == Robust::EXPECTED ? mean(tts_sum) : tts_worst; }
+
+    inline unsigned long long int mean(unsigned long long int sum) const { return (sum + burned.size() / 2) / burned.size(); }
+};
+
+/*
+    Fire spread of one allocation in all scenarios at once. Arrival times are
+    stored scenario-major per node (the lanes of node u start at u * width),
+    so relaxing an arc is a loop over contiguous lanes without branches that
+    the compiler turns into SIMD add/min instructions. Nodes are processed
+    label-correcting from a heap keyed by the earliest lane that improved; a
+    node goes back to the heap when a later relaxation lowers any of its
+    lanes. Only arrival times before H are propagated, which is all the
+    burned nodes and the time to survival depend on. The buffers are kept
+    between calls and only the lanes of reached nodes are reset.
+*/
+class ScenarioEvaluator {
+   private:
+    static constexpr unsigned UNREACHED = numeric_limits<int>::max();
+
+    Instance* _I = nullptr;
+    const Scenarios* _S = nullptr;
+    vector<unsigned> _a;
+    vector<unsigned> _key;  // Key of a queued node, UNREACHED otherwise
+    vector<char> _reached;
+    vector<unsigned> _touched;
+    Heap _heap{0};
+    ScenarioScore _score;
+
+   public:
+    void attach(Instance& I, const Scenarios* S) {
+        _I = &I;
+        _S = S;
+        _a.assign(size_t(I.n) * S->width(), UNREACHED);
+        _key.assign(I.n, UNREACHED);
+        _reached.assign(I.n, false);
+        _touched.clear();
+        _heap = Heap(I.n);
+    }
+
+    // Scores the allocation given by 'has_resource'; the result stays valid until the next call
+    const ScenarioScore& evaluate(const ResourceSet& has_resource) {
+        const unsigned W = _S->width(), H = _I->H, Delta = _I->Delta;
+        const vector<unsigned>& out_offset = _I->G.get_outgoing_offsets();
+        for (unsigned u : _touched) {
+            fill_n(_a.begin() + size_t(u) * W, W, UNREACHED);
+            _reached[u] = false;
+        }
+        _touched.clear();
+        _heap.clear();
+
+        for (unsigned ign : _I->ignitions)
+            if (_I->ignition_time[ign] < H) {
+                fill_n(_a.begin() + size_t(ign) * W, W, _I->ignition_time[ign]);
+                _reached[ign] = true;
+                _touched.push_back(ign);
+                _key[ign] = _I->ignition_time[ign];
+                _heap.insertElement(ign, _key[ign]);
+            }
+        while (!_heap.empty()) {
+            unsigned u = _heap.findAndDeleteMinElement();
+            _key[u] = UNREACHED;
+            const unsigned* __restrict au = _a.data() + size_t(u) * W;
+            unsigned delay = has_resource[u] ? Delta : 0;
+            span<const Arc> arcs = _I->get_outgoing_arcs(u);
+            for (unsigned idx = 0; idx < arcs.size(); idx++) {
+                unsigned v = arcs[idx].node;
+                if (v == u)
+                    continue;
+                const unsigned* __restrict w = _S->weights(out_offset[u] + idx);
+                unsigned* __restrict av = _a.data() + size_t(v) * W;
+                unsigned low = UNREACHED;
+                for (unsigned k = 0; k < W; k++) {
+                    unsigned c = au[k] + w[k] + delay;
+                    bool better = c < av[k] && c < H;
+                    av[k] = better ? c : av[k];
+                    low = min(low, better ? c : UNREACHED);
+                }
+                if (low == UNREACHED)
+                    continue;
+                if (!_reached[v]) {
+                    _reached[v] = true;
+                    _touched.push_back(v);
+                }
+                if (low < _key[v]) {
+                    _key[v] = low;
+                    _heap.adjustHeap(v, low);
+                }
+            }
+        }
+
+        unsigned count = _S->count();
+        _score.burned.assign(count, 0);
+        _score.time_to_survival.assign(count, 0);
+        for (unsigned u : _touched) {
+            const unsigned* au = _a.data() + size_t(u) * W;
+            for (unsigned k = 0; k < count; k++) {
+                _score.burned[k] += au[k] < H;
+                _score.time_to_survival[k] += au[k] < H ? H - au[k] : 0;
+            }
+        }
+        _score.burned_sum = _score.tts_sum = 0;
+        _score.burned_worst = 0;
+        _score.tts_worst = 0;
+        for (unsigned k = 0; k < count; k++) {
+            _score.burned_sum += _score.burned[k];
+            _score.tts_sum += _score.time_to_survival[k];
+            _score.burned_worst = max(_score.burned_worst, _score.burned[k]);
+            _score.tts_worst = max(_score.tts_worst, _score.time_to_survival[k]);
+        }
+        return _score;
+    }
+};
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+#include "algorithm.hpp"
+#include "incumbent.hpp"
+#include "feasibility.hpp"
+#include "warm_start.hpp"
+#include "deadline.hpp"
+
+/*
+    Resident re-planning server (fire --serve). Requests and responses are
+    JSON lines, read from stdin and written to stdout, or exchanged over the
+    connections of a Unix domain socket. A request holds
+
+        "instance"     path of the instance (required)
+        "id"           copied into the response
+        "timelimit"    seconds, counted from the arrival of the request
+        "maxiter", "target", "seed", "beta", "eta", "c", "p", "phat", "zmax", "bounded"
+        "incumbent"    solution to warm start from (at least "resourceAllocation")
+        "replan_from"  with "incumbent", re-plan every instant from this one on
+        "fire_path"    include "pred" and "fireArrivalTime" in the response
+
+    Missing fields take the values given on the command line. The response is
+    the best solution found plus "iterations", "budget" and "time", or an
+    "error". Instances are loaded once and kept; algorithms are kept per
+    instance and parameters, so a repeated query skips building A0 and reuses
+    grown buffers. Requests are served by a pool of workers, earliest deadline
+    first. The search stops at the deadline even inside an iteration, so a
+    request answered late returns the plan of the levels completed so far.
+    SIGTERM cancels the searches in progress and stops reading requests; the
+    requests received so far are answered with what was found, and the
+    server exits.
+*/
+class Server {
+   private:
+    // Where the responses of a request go; the descriptor is closed with the last reference
+    struct Connection {
+        int fd;
+        bool socket;
+        mutex m;
+        Connection(int _fd, bool _socket) : fd(_fd), socket(_socket) {}
+        ~Connection() {
+            if (socket)
+                close(fd);
+        }
+        void send(const string& line) {
+            lock_guard<mutex> lock(m);
+            for (size_t done = 0; done < line.size();) {
+                ssize_t n = socket ? ::send(fd, line.data() + done, line.size() - done, MSG_NOSIGNAL)
+                                   : write(fd, line.data() + done, line.size() - done);
+                if (n <= 0)
+                    return;
+                done += n;
+            }
+        }
+    };
+
+    struct Request {
+        json data;
+        std::shared_ptr<Connection> connection;
+        chrono::steady_clock::time_point arrival, deadline;
+        unsigned long long int sequence;
+        // Earliest deadline first, then first come first served
+        bool operator<(const Request& other) const {
+            return deadline > other.deadline || (deadline == other.deadline && sequence > other.sequence);
+        }
+    };
+
+    json _defaults;
+    unsigned _n_workers;
+    vector<thread> _workers;
+    mutex _m;
+    condition_variable _cv;
+    priority_queue<Request> _queue;
+    unsigned long long int _sequence;
+    bool _closing;
+
+    // Cancelled by SIGTERM; the deadline of every request expires with it
+    Deadline _shutdown;
+    inline static Server* _serving = nullptr;
+    static void stop(int) {
+        if (_serving)
+            _serving->_shutdown.cancel();
+    }
+
+    // Connections still being read, so shutting down can stop and wait for their readers
+    mutex _readers_m;
+    condition_variable _readers_cv;
+    set<Connection*> _reading;
+
+    // Loaded instances and idle algorithms (by instance and parameters)
+    mutex _cache_m;
+    map<string, shared_future<std::shared_ptr<Instance>>> _instances;
+    map<string, vector<unique_ptr<Algorithm>>> _idle;
+
+    // Other requests for an instance that is being loaded wait for that load instead of repeating it
+    std::shared_ptr<Instance> instance(const string& path) {
+        promise<std::shared_ptr<Instance>> loaded;
+        shared_future<std::shared_ptr<Instance>> future;
+        bool load = false;
+        {
+            lock_guard<mutex> lock(_cache_m);
+            auto it = _instances.find(path);
+            if (it != _instances.end())
+                future = it->second;
+            else {
+                future = loaded.get_future().share();
+                _instances.emplace(path, future);
+                load = true;
+            }
+        }
+        if (load) {
+            // A failed load is reported to every waiting request and forgotten, so the path can be retried
+            try {
+                auto I = make_shared<Instance>();
+                I->read_instance(path);
+                loaded.set_value(I);
+            } catch (...) {
+                loaded.set_exception(current_exception());
+                lock_guard<mutex> lock(_cache_m);
+                _instances.erase(path);
+            }
+        }
+        return future.get();
+    }
+
+    unique_ptr<Algorithm> acquire(const string& key, Instance& I, const json& params) {
+        {
+            lock_guard<mutex> lock(_cache_m);
+            vector<unique_ptr<Algorithm>>& idle = _idle[key];
+            if (!idle.empty()) {
+                unique_ptr<Algorithm> alg = std::move(idle.back());
+                idle.pop_back();
+                return alg;
+            }
+        }
+        return make_unique<Algorithm>(I, 0, params["p"].get<double>(), params["phat"].get<double>(), params["beta"].get<unsigned>(),
+                                      params["eta"].get<unsigned>(), params["zmax"].get<unsigned>(), params["c"].get<unsigned>(), 1,
+                                      params["bounded"].get<bool>());
+    }
+
+    void release(const string& key, unique_ptr<Algorithm> alg) {
+        alg->set_deadline(nullptr);
+        lock_guard<mutex> lock(_cache_m);
+        _idle[key].push_back(std::move(alg));
+    }
+
+    json solve(Request& request) {
+        json& data = request.data;
+        json params = _defaults;
+        for (const char* name : {"beta", "eta", "c", "p", "phat", "zmax", "bounded"})
+            if (data.contains(name))
+                params[name] = data[name];
+        string path = data.at("instance").get<string>();
+        std::shared_ptr<Instance> I = instance(path);
+        unsigned maxiter = data.value("maxiter", _defaults["maxiter"].get<unsigned>());
+        unsigned target = data.value("target", _defaults["target"].get<unsigned>());
+
+        string key = path + params.dump();
+        unique_ptr<Algorithm> alg = acquire(key, *I, params);
+        Deadline deadline(request.deadline, &_shutdown);
+        json response;
+        try {
+            alg->reset(data.value("seed", _defaults["seed"].get<unsigned>()));
+            alg->set_deadline(&deadline);
+            Incumbent incumbent(*I);
+            Verifier verifier(*I);
+            if (data.contains("incumbent")) {
+                Solution previous(*I);
+                previous.read_json(data["incumbent"]);
+                unsigned levels = kept_levels(*I, previous.allocation, data.value("replan_from", numeric_limits<unsigned>::max()));
+                string error;
+                if (!fix_levels(*alg, *I, previous.allocation, levels, verifier, error))
+                    throw invalid_argument(error);
+                seed_incumbent(*alg, *I, previous.allocation, incumbent, verifier);
+            }
+            unsigned it = 0;
+            do {
+                it++;
+                const Solution& current = alg->beam_search(incumbent.bkv());
+                unsigned et = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - request.arrival).count();
+                incumbent.update(current, et, it, alg->get_budget());
+            } while (it < maxiter && incumbent.bkv() > target && !deadline.expired());
+
+            Solution& B = incumbent.best();
+            alg->complete_fire_path(B);
+            response = B.to_json(!data.value("fire_path", false));
+            response["iterations"] = it;
+            response["budget"] = alg->get_budget();
+        } catch (...) {
+            release(key, std::move(alg));
+            throw;
+        }
+        release(key, std::move(alg));
+        return response;
+    }
+
+    void work() {
+        while (true) {
+            Request request;
+            {
+                unique_lock<mutex> lock(_m);
+                _cv.wait(lock, [&] { return _closing || !_queue.empty(); });
+                if (_queue.empty())
+                    return;
+                request = _queue.top();
+                _queue.pop();
+            }
+            json response;
+            try {
+                response = solve(request);
+            } catch (const std::exception& e) {
+                response = {{"error", e.what()}};
+            }
+            if (request.data.contains("id"))
+                response["id"] = request.data["id"];
+            response["time"] = chrono::duration<double>(chrono::steady_clock::now() - request.arrival).count();
+            request.connection->send(response.dump() + "\n");
+        }
+    }
+
+    void submit(const string& line, std::shared_ptr<Connection> connection) {
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            return;
+        Request request;
+        request.connection = connection;
+        request.arrival = chrono::steady_clock::now();
+        try {
+            request.data = json::parse(line);
+            if (!request.data.is_object())
+                throw invalid_argument("A request must be a JSON object");
+            double timelimit = request.data.value("timelimit", _defaults["timelimit"].get<double>());
+            request.deadline = request.arrival + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timelimit));
+        } catch (const std::exception& e) {
+            connection->send(json({{"error", e.what()}}).dump() + "\n");
+            return;
+        }
+        {
+            lock_guard<mutex> lock(_m);
+            request.sequence = _sequence++;
+            _queue.push(std::move(request));
+        }
+        _cv.notify_one();
+    }
+
+    // Threads of the server do not take SIGTERM, so it interrupts the read() or accept() of the serving thread
+    template <class F>
+    static thread spawn(F f) {
+        sigset_t term, previous;
+        sigemptyset(&term);
+        sigaddset(&term, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &term, &previous);
+        thread t(std::move(f));
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        return t;
+    }
+
+    // Submits the lines read from 'fd' until it is closed or the server shuts down; responses go to 'connection'
+    void read_requests(int fd, std::shared_ptr<Connection> connection) {
+        string buffer;
+        char chunk[4096];
+        while (true) {
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR && !_shutdown.expired())
+                continue;
+            if (n <= 0)
+                break;
+            buffer.append(chunk, n);
+            size_t start = 0, end;
+            while ((end = buffer.find('\n', start)) != string::npos) {
+                submit(buffer.substr(start, end - start), connection);
+                start = end + 1;
+            }
+            buffer.erase(0, start);
+        }
+        // A last line without newline, unless reading stopped at a shutdown
+        if (!_shutdown.expired())
+            submit(buffer, connection);
+    }
+
+   public:
+    Server(const json& defaults, unsigned n_workers) : _defaults(defaults), _n_workers(max(n_workers, 1u)), _sequence(0), _closing(false) {}
+
+    ~Server() {
+        _serving = nullptr;
+        {
+            lock_guard<mutex> lock(_m);
+            _closing = true;
+        }
+        _cv.notify_all();
+        for (thread& t : _workers)
+            t.join();
+    }
+
+    // Serves stdin until it is closed, or the socket at 'socket_path', until SIGTERM
+    int run(const string& socket_path) {
+        signal(SIGPIPE, SIG_IGN);
+        // Without SA_RESTART, so a blocked read() or accept() returns
+        _serving = this;
+        struct sigaction action = {};
+        action.sa_handler = stop;
+        sigaction(SIGTERM, &action, nullptr);
+        for (unsigned w = 0; w < _n_workers; w++)
+            _workers.push_back(spawn([this] { work(); }));
+
+        if (socket_path.empty()) {
+            read_requests(STDIN_FILENO, make_shared<Connection>(STDOUT_FILENO, false));
+            return 0;
+        }
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path)) {
+            cerr << "Socket path is too long: " << socket_path << endl;
+            return 1;
+        }
+        socket_path.copy(address.sun_path, socket_path.size());
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socket_path.c_str());
+        if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0) {
+            cerr << "Could not listen on socket: " << socket_path << endl;
+            return 1;
+        }
+        while (!_shutdown.expired()) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            auto connection = make_shared<Connection>(fd, true);
+            {
+                lock_guard<mutex> lock(_readers_m);
+                _reading.insert(connection.get());
+            }
+            spawn([this, connection] {
+                read_requests(connection->fd, connection);
+                lock_guard<mutex> lock(_readers_m);
+                _reading.erase(connection.get());
+                _readers_cv.notify_all();
+            }).detach();
+        }
+        close(listener);
+        unlink(socket_path.c_str());
+        // Stops reading the open connections; their responses are still sent
+        unique_lock<mutex> lock(_readers_m);
+        for (Connection* connection : _reading)
+            ::shutdown(connection->fd, SHUT_RD);
+        _readers_cv.wait(lock, [&] { return _reading.empty(); });
+        return 0;
+    }
+};
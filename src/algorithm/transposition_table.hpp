@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+#include "solution.hpp"
+
+/*
+    Beam members kept across iterations, keyed by (level, fingerprint of the
+    resource set). Arrival times follow from the set of protected nodes
+    alone, so a cached member can stand in for any partial solution with the
+    same key: its scores replace a delta() and its fire path replaces an
+    add_resource(). Entries are evicted least recently used first once their
+    estimated footprint exceeds the capacity. find() does not modify the
+    table, so it may be called from several threads while nothing is
+    inserted; touch() and insert() are serial.
+*/
+class TranspositionTable {
+   public:
+    static constexpr unsigned NONE = numeric_limits<unsigned>::max();
+
+    struct Stats {
+        unsigned long long int lookups = 0, hits = 0;      // Trials of step()
+        unsigned long long int survivors = 0, reused = 0;  // Members materialized by prune()
+        unsigned long long int inserts = 0, evictions = 0;
+        unsigned long long int entries = 0, bytes = 0;
+
+        void merge(const Stats& other) {
+            lookups += other.lookups;
+            hits += other.hits;
+            survivors += other.survivors;
+            reused += other.reused;
+            inserts += other.inserts;
+            evictions += other.evictions;
+            entries += other.entries;
+            bytes += other.bytes;
+        }
+    };
+
+   private:
+    struct Entry {
+        unsigned level;
+        uint64_t fingerprint;
+        size_t bytes;
+        unsigned prev, next;
+        Solution sol;
+    };
+
+    size_t _capacity;
+    size_t _used;
+    vector<Entry> _entries;
+    vector<unsigned> _free;
+    unordered_map<uint64_t, unsigned> _index;
+    unsigned _head, _tail;  // Most and least recently used
+
+    static inline uint64_t key(unsigned level, uint64_t fingerprint) {
+        return fingerprint ^ (0x9E3779B97F4A7C15ull * (level + 1));
+    }
+
+    static size_t footprint(const Solution& sol) {
+        return sizeof(Entry) + sol.fire_path.a.size() * 2 * sizeof(unsigned) + sol.has_resource.size() / 8 +
+               sol.allocation.size() * sizeof(pair<unsigned, unsigned>) + 4 * sizeof(void*);
+    }
+
+    void unlink(unsigned idx) {
+        Entry& e = _entries[idx];
+        (e.prev == NONE ? _head : _entries[e.prev].next) = e.next;
+        (e.next == NONE ? _tail : _entries[e.next].prev) = e.prev;
+    }
+
+    void push_front(unsigned idx) {
+        Entry& e = _entries[idx];
+        e.prev = NONE;
+        e.next = _head;
+        (_head == NONE ? _tail : _entries[_head].prev) = idx;
+        _head = idx;
+    }
+
+    void evict() {
+        unsigned idx = _tail;
+        unlink(idx);
+        _index.erase(key(_entries[idx].level, _entries[idx].fingerprint));
+        _used -= _entries[idx].bytes;
+        _free.push_back(idx);
+        stats.evictions++;
+    }
+
+   public:
+    Stats stats;
+
+    TranspositionTable(size_t capacity) : _capacity(capacity), _used(0), _head(NONE), _tail(NONE) {}
+
+    // Index of the entry for (level, fingerprint), or NONE
+    unsigned find(unsigned level, uint64_t fingerprint) const {
+        auto it = _index.find(key(level, fingerprint));
+        if (it == _index.end())
+            return NONE;
+        const Entry& e = _entries[it->second];
+        return e.level == level && e.fingerprint == fingerprint ? it->second : NONE;
+    }
+
+    inline const Solution& get(unsigned idx) const { return _entries[idx].sol; }
+
+    // Marks an entry returned by find() as the most recently used
+    void touch(unsigned idx) {
+        if (idx == _head)
+            return;
+        unlink(idx);
+        push_front(idx);
+    }
+
+    // Stores 'sol' as the member of 'level' for its resource set (or refreshes the entry)
+    void insert(unsigned level, const Solution& sol) {
+        uint64_t k = key(level, sol.fingerprint);
+        auto it = _index.find(k);
+        if (it != _index.end()) {
+            touch(it->second);
+            return;
+        }
+        size_t bytes = footprint(sol);
+        if (bytes > _capacity)
+            return;
+        while (_used + bytes > _capacity)
+            evict();
+        unsigned idx;
+        if (!_free.empty()) {
+            idx = _free.back();
+            _free.pop_back();
+            _entries[idx].sol = sol;
+        } else {
+            idx = _entries.size();
+            _entries.push_back({level, sol.fingerprint, 0, NONE, NONE, sol});
+        }
+        Entry& e = _entries[idx];
+        e.level = level;
+        e.fingerprint = sol.fingerprint;
+        e.bytes = bytes;
+        push_front(idx);
+        _index.emplace(k, idx);
+        _used += bytes;
+        stats.inserts++;
+    }
+
+    inline unsigned size() const { return _index.size(); }
+
+    inline size_t memory() const { return _used; }
+};
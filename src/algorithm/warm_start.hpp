@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "algorithm.hpp"
+#include "incumbent.hpp"
+#include "feasibility.hpp"
+
+/*
+    A warm start keeps the levels of a previous allocation that still match
+    the schedule: resources deployed at exactly the instants and quantities
+    of the first levels of R, and before 'replan_from'. Beam search then only
+    re-plans from the first changed instant on.
+*/
+unsigned kept_levels(Instance& I, const vector<pair<unsigned, unsigned>>& allocation, unsigned replan_from) {
+    map<unsigned, unsigned> used;
+    for (auto const& [node, instant] : allocation)
+        used[instant]++;
+    unsigned levels = 0;
+    while (levels < I.R.size() && I.R[levels].first < replan_from && used[I.R[levels].first] == I.R[levels].second)
+        levels++;
+    // Instants of the previous schedule that are gone invalidate the levels after them
+    for (auto const& [instant, count] : used) {
+        unsigned level = lower_bound(I.R.begin(), I.R.end(), make_pair(instant, 0u)) - I.R.begin();
+        if (count > 0 && (level == I.R.size() || I.R[level].first != instant))
+            levels = min(levels, level);
+    }
+    return levels;
+}
+
+// Fixes the first 'levels' levels of 'alg'; returns false and sets 'error' if they are no longer feasible
+bool fix_levels(Algorithm& alg, Instance& I, const vector<pair<unsigned, unsigned>>& allocation, unsigned levels, Verifier& verifier, string& error) {
+    Solution root(I);
+    root = alg.fix_prefix(allocation, levels);
+    alg.complete_fire_path(root);
+    if (verifier.check(root))
+        return true;
+    error = "The warm start cannot be kept: " + verifier.error();
+    return false;
+}
+
+// Makes the whole previous allocation the incumbent if it is still feasible; returns its objective value
+unsigned seed_incumbent(Algorithm& alg, Instance& I, const vector<pair<unsigned, unsigned>>& allocation, Incumbent& incumbent, Verifier& verifier) {
+    Solution sol(I);
+    alg.replay(sol, allocation);
+    alg.complete_fire_path(sol);
+    if (!verifier.check(sol))
+        return numeric_limits<unsigned>::max();
+    incumbent.update(sol, alg.score(sol), 0, 0, 0);
+    return sol.objv;
+}
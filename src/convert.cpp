@@ -0,0 +1,49 @@
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "instance.hpp"
+
+
+int main(int argc, char *argv[]) {
+    // 1) Parse input
+    vector<string> instances;
+    string output_dir;
+    po::options_description general("General options");
+    general.add_options()("help", "Show this message.")
+                         ("instances", po::value<vector<string>>(&instances)->multitoken(), "JSON instance files to convert.")
+                         ("output", po::value<string>(&output_dir)->default_value(""), "Output directory (defaults to the directory of each instance).");
+    po::positional_options_description pod;
+    pod.add("instances", -1);
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(general).positional(pod).run(), vm);
+    po::notify(vm);
+    if (vm.count("help") || instances.empty()) {
+        cout << "Converts JSON instances into the binary format read by 'fire'." << endl;
+        cout << general << endl;
+        return instances.empty() && !vm.count("help");
+    }
+
+    // 2) Convert each instance to <name>.bin
+    for (const string& path : instances) {
+        string::size_type slash = path.find_last_of("/");
+        string dir = slash == string::npos ? "" : path.substr(0, slash + 1);
+        string base_filename = path.substr(slash == string::npos ? 0 : slash + 1);
+        string name = base_filename.substr(0, base_filename.find_last_of('.'));
+        string target = (output_dir.empty() ? dir : output_dir + "/") + name + ".bin";
+
+        Instance I;
+        try {
+            I.read_instance(path);
+            I.write_binary_instance(target);
+        } catch (const std::exception& e) {
+            cerr << path << ": " << e.what() << endl;
+            return 1;
+        }
+        cout << path << " -> " << target << " (" << I.n << " nodes, " << I.get_number_of_edges() << " arcs)" << endl;
+    }
+}
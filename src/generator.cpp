@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+
+// Blurs 'field' in place with a box filter of the given radius (separable, clamped at the border)
+void box_blur(vector<double>& field, unsigned width, unsigned height, unsigned radius) {
+    vector<double> tmp(field.size());
+    for (unsigned pass = 0; pass < 2; pass++) {
+        for (unsigned j = 0; j < height; j++) {
+            double sum = 0;
+            unsigned count = 0;
+            for (unsigned i = 0; i < min(radius, width); i++, count++)
+                sum += field[j * width + i];
+            for (unsigned i = 0; i < width; i++) {
+                if (i + radius < width) { sum += field[j * width + i + radius]; count++; }
+                if (i > radius) { sum -= field[j * width + i - radius - 1]; count--; }
+                tmp[j * width + i] = sum / count;
+            }
+        }
+        for (unsigned i = 0; i < width; i++) {
+            double sum = 0;
+            unsigned count = 0;
+            for (unsigned j = 0; j < min(radius, height); j++, count++)
+                sum += tmp[j * width + i];
+            for (unsigned j = 0; j < height; j++) {
+                if (j + radius < height) { sum += tmp[(j + radius) * width + i]; count++; }
+                if (j > radius) { sum -= tmp[(j - radius - 1) * width + i]; count--; }
+                field[j * width + i] = sum / count;
+            }
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    // 1) Parse input
+    struct Options {
+        string output;
+        vector<string> ignitions;
+        unsigned width, height, neighbors, seed, radius;
+        unsigned horizon, delay, instants, interval, quantity;
+        double mean, spread, wind, density;
+    };
+    Options opt;
+    po::options_description general("Landscape");
+    general.add_options()("help", "Show this message.")
+                         ("output", po::value<string>(&opt.output), "Path of the generated instance.")
+                         ("width", po::value<unsigned>(&opt.width)->default_value(100), "Number of columns of the grid.")
+                         ("height", po::value<unsigned>(&opt.height)->default_value(100), "Number of rows of the grid.")
+                         ("neighbors", po::value<unsigned>(&opt.neighbors)->default_value(4), "Arcs per cell (4 or 8).")
+                         ("density", po::value<double>(&opt.density)->default_value(1.0), "Fraction of cells kept as nodes.")
+                         ("mean", po::value<double>(&opt.mean)->default_value(5.5), "Mean arc weight.")
+                         ("spread", po::value<double>(&opt.spread)->default_value(2.0), "Standard deviation of the arc weights.")
+                         ("radius", po::value<unsigned>(&opt.radius)->default_value(5), "Correlation radius of the weight field (in cells).")
+                         ("wind", po::value<double>(&opt.wind)->default_value(0.0), "Weight reduction of arcs pointing east, in [0, 1).")
+                         ("ignition", po::value<vector<string>>(&opt.ignitions)->default_value({"center"}, "center"), "Ignition cell: 'center', 'random', 'i,j' or 'i,j,t' (starting at t); may be repeated.")
+                         ("seed", po::value<unsigned>(&opt.seed)->default_value(1), "Seed value.");
+    po::options_description schedule("Resources");
+    schedule.add_options()("horizon", po::value<unsigned>(&opt.horizon)->default_value(0), "Arrival time target (0 = scaled with the grid).")
+                          ("delay", po::value<unsigned>(&opt.delay)->default_value(0), "Delay caused by a resource (0 = five intervals).")
+                          ("instants", po::value<unsigned>(&opt.instants)->default_value(4), "Number of instants at which resources arrive.")
+                          ("interval", po::value<unsigned>(&opt.interval)->default_value(0), "Time between two instants (0 = horizon / 7).")
+                          ("quantity", po::value<unsigned>(&opt.quantity)->default_value(3), "Resources available at each instant.");
+    general.add(schedule);
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(general).run(), vm);
+    po::notify(vm);
+    if (vm.count("help") || !vm.count("output")) {
+        cout << "Generates a grid landscape in the JSON instance format." << endl;
+        cout << general << endl;
+        return !vm.count("help");
+    }
+    if (opt.neighbors != 4 && opt.neighbors != 8) {
+        cerr << "The number of neighbors must be 4 or 8." << endl;
+        return 1;
+    }
+    unsigned W = opt.width, Hg = opt.height;
+    mt19937 gen(opt.seed);
+
+    // 2) Spatially correlated spread-time field
+    normal_distribution<double> noise(0, 1);
+    vector<double> field(size_t(W) * Hg);
+    for (double& f : field)
+        f = noise(gen);
+    if (opt.radius > 0)
+        box_blur(field, W, Hg, opt.radius);
+    double mean = 0, var = 0;
+    for (double f : field)
+        mean += f;
+    mean /= field.size();
+    for (double f : field)
+        var += (f - mean) * (f - mean);
+    double sd = sqrt(var / field.size());
+    for (double& f : field)
+        f = opt.mean + opt.spread * (sd > 0 ? (f - mean) / sd : 0);
+
+    // 3) Nodes and ignitions (cell and start time)
+    vector<array<unsigned, 3>> ignitions;
+    for (const string& ignition : opt.ignitions) {
+        unsigned ign_i = W / 2, ign_j = Hg / 2, ign_t = 0;
+        if (ignition == "random") {
+            ign_i = uniform_int_distribution<unsigned>(0, W - 1)(gen);
+            ign_j = uniform_int_distribution<unsigned>(0, Hg - 1)(gen);
+        } else if (ignition != "center") {
+            char comma;
+            istringstream(ignition) >> ign_i >> comma >> ign_j >> comma >> ign_t;
+            if (ign_i >= W || ign_j >= Hg) {
+                cerr << "Ignition cell is outside the grid." << endl;
+                return 1;
+            }
+        }
+        ignitions.push_back({ign_i, ign_j, ign_t});
+    }
+    uniform_real_distribution<double> dist01(0, 1);
+    vector<bool> present(field.size());
+    for (size_t c = 0; c < field.size(); c++)
+        present[c] = dist01(gen) < opt.density;
+    for (auto const& [ign_i, ign_j, ign_t] : ignitions)
+        present[size_t(ign_j) * W + ign_i] = true;
+
+    // 4) Resource schedule
+    unsigned horizon = opt.horizon ? opt.horizon : max(10u, unsigned(opt.mean * min(W, Hg) / 3));
+    unsigned interval = opt.interval ? opt.interval : max(1u, horizon / 7);
+    unsigned delay = opt.delay ? opt.delay : 5 * interval;
+
+    // 5) Write the instance; the output is streamed because large grids have millions of arcs
+    ofstream out(opt.output);
+    if (!out.good()) {
+        cerr << "Could not create file: " << opt.output << endl;
+        return 1;
+    }
+    out << "{\n    \"Delay\": " << delay << ",\n    \"ArrivalTimeTarget\": " << horizon << ",\n    \"ResAtTime\": {";
+    for (unsigned k = 1; k <= opt.instants; k++)
+        out << (k > 1 ? "," : "") << "\n        \"" << k * interval << "\": " << opt.quantity;
+    out << "\n    },\n    \"Ignitions\": [";
+    for (unsigned k = 0; k < ignitions.size(); k++) {
+        auto const& [ign_i, ign_j, ign_t] = ignitions[k];
+        out << (k ? ", [" : "[") << ign_i << ", " << ign_j;
+        if (ign_t > 0)
+            out << ", " << ign_t;
+        out << "]";
+    }
+    out << "],\n    \"Nodes\": [";
+    bool first = true;
+    for (unsigned i = 0; i < W; i++)
+        for (unsigned j = 0; j < Hg; j++)
+            if (present[size_t(j) * W + i]) {
+                out << (first ? "" : ",") << "\n        [" << i << ", " << j << "]";
+                first = false;
+            }
+    out << "\n    ],\n    \"Arcs\": {";
+    first = true;
+    unsigned long long int arcs = 0;
+    for (unsigned i = 0; i < W; i++)
+        for (unsigned j = 0; j < Hg; j++) {
+            if (!present[size_t(j) * W + i])
+                continue;
+            for (int di = -1; di <= 1; di++)
+                for (int dj = -1; dj <= 1; dj++) {
+                    bool diagonal = di != 0 && dj != 0;
+                    if ((di == 0 && dj == 0) || (diagonal && opt.neighbors == 4))
+                        continue;
+                    long k = long(i) + di, l = long(j) + dj;
+                    if (k < 0 || l < 0 || k >= long(W) || l >= long(Hg) || !present[size_t(l) * W + k])
+                        continue;
+                    double w = 0.5 * (field[size_t(j) * W + i] + field[size_t(l) * W + k]);
+                    w *= (1.0 - opt.wind * di) * (diagonal ? sqrt(2.0) : 1.0);
+                    out << (first ? "" : ",") << "\n        \"((" << i << ", " << j << "), (" << k << ", " << l << "))\": "
+                        << max(1l, lround(w));
+                    first = false;
+                    arcs++;
+                }
+        }
+    out << "\n    }\n}" << endl;
+    cout << opt.output << ": " << count(present.begin(), present.end(), true) << " nodes, " << arcs << " arcs, horizon " << horizon << endl;
+}
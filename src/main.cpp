@@ -1,8 +1,12 @@
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 using namespace std;
 
 #include <boost/program_options.hpp>
@@ -15,19 +19,40 @@ using json = nlohmann::json;
 using namespace std::chrono;
 
 #include "algorithm.hpp"
+#include "incumbent.hpp"
 #include "feasibility.hpp"
+#include "checkpoint.hpp"
+#include "stream_writer.hpp"
+#include "warm_start.hpp"
+#include "server.hpp"
+#include "scenarios.hpp"
+#include "scenario_evaluator.hpp"
+#include "controller.hpp"
+#include "deadline.hpp"
+
+
+// Set by SIGTERM: the running iterations are cut short and dropped, and the run is checkpointed
+atomic<bool> stop_requested = false;
+Deadline run_deadline;  // Time limit of the run, also cancelled by SIGTERM
+void request_stop(int) {
+    stop_requested = true;
+    run_deadline.cancel();
+}
 
 
 int main(int argc, char *argv[]) {
     // 1) Parse input
     struct Options {
-        string instance;
-        unsigned timelimit, seed, max_iterations;
-        unsigned target;
+        string instance, profile, checkpoint, stream, warmstart, socket, robust, evaluate;
+        unsigned checkpoint_interval, replan_from, workers, scenarios, scenario_seed, table_memory;
+        double spread;
+        double timelimit;
+        unsigned seed, max_iterations, threads, portfolio;
+        unsigned target, target_iterations;
         unsigned beta, eta, zmax, c;
         unsigned long long int budget;
         double p, phat;
-        bool verbose, save;
+        bool verbose, save, compact, bounded, verify, resume, serve, trial_parallel;
     };
     Options opt;
     po::options_description general("General options");
@@ -36,16 +61,43 @@ int main(int argc, char *argv[]) {
                          ("target", po::value<unsigned>(&opt.target)->default_value(0), "Target objective value.")
                          ("maxiter", po::value<unsigned>(&opt.max_iterations)->default_value(numeric_limits<unsigned>::max()), "Maximum number of iterations.")
                          ("budget", po::value<unsigned long long int>(&opt.budget)->default_value(numeric_limits<unsigned long long int>::max()), "Maximum number of subtree updates.")
-                         ("timelimit", po::value<unsigned>(&opt.timelimit)->default_value(7200), "Maximum running time (in seconds).")
+                         ("timelimit", po::value<double>(&opt.timelimit)->default_value(7200), "Maximum running time (in seconds); an iteration running at the limit is cut short.")
                          ("save", po::bool_switch(&opt.save)->default_value(false), "Save best-found solution.")
-                         ("seed", po::value<unsigned>(&opt.seed)->default_value(123), "Seed value.");
+                         ("stream", po::value<string>(&opt.stream)->default_value(""), "Append one JSON line per improvement to this file or FIFO.")
+                         ("compact", po::bool_switch(&opt.compact)->default_value(false), "Leave the fire path out of saved and streamed solutions.")
+                         ("verify", po::bool_switch(&opt.verify)->default_value(false), "Check the feasibility of every new best solution.")
+                         ("profile", po::value<string>(&opt.profile)->default_value(""), "Write a JSON profiling report to this file (needs a build with -DPROFILE=ON).")
+                         ("checkpoint", po::value<string>(&opt.checkpoint)->default_value(""), "Periodically save the state of the run to this file (and on SIGTERM).")
+                         ("checkpoint-interval", po::value<unsigned>(&opt.checkpoint_interval)->default_value(300), "Time between two checkpoints (in seconds).")
+                         ("resume", po::bool_switch(&opt.resume)->default_value(false), "Continue from the checkpoint file if it exists.")
+                         ("warmstart", po::value<string>(&opt.warmstart)->default_value(""), "Solution file of a previous run: its decisions before the first changed instant are kept.")
+                         ("replan-from", po::value<unsigned>(&opt.replan_from)->default_value(numeric_limits<unsigned>::max()), "With --warmstart, also re-plan every instant from this one on.")
+                         ("seed", po::value<unsigned>(&opt.seed)->default_value(123), "Seed value.")
+                         ("bounded", po::bool_switch(&opt.bounded)->default_value(false), "Stop incremental shortest-path updates at the horizon (arrival times beyond it are completed at the end).")
+                         ("threads", po::value<unsigned>(&opt.threads)->default_value(1), "Number of threads used to expand the beam.")
+                         ("trial-parallel", po::bool_switch(&opt.trial_parallel)->default_value(false), "Spread the trials of each beam member over the threads instead of the beam members (for narrow beams).")
+                         ("portfolio", po::value<unsigned>(&opt.portfolio)->default_value(1), "Number of cooperating searches sharing the incumbent (search k uses seed + k).")
+                         ("table-memory", po::value<unsigned>(&opt.table_memory)->default_value(0), "Memory (in MB) of each search's table of beam members reused across iterations (0 = off).");
+    po::options_description server("Server");
+    server.add_options()("serve", po::bool_switch(&opt.serve)->default_value(false), "Answer JSON-line re-planning requests from stdin (or --socket) instead of solving one instance.")
+                        ("socket", po::value<string>(&opt.socket)->default_value(""), "Path of the Unix domain socket to serve on.")
+                        ("workers", po::value<unsigned>(&opt.workers)->default_value(thread::hardware_concurrency()), "Number of requests solved at the same time.");
+    general.add(server);
+    po::options_description scenario_options("Scenarios");
+    scenario_options.add_options()("scenarios", po::value<unsigned>(&opt.scenarios)->default_value(0), "Number of perturbed weight scenarios (0 = nominal weights only).")
+                                  ("spread", po::value<double>(&opt.spread)->default_value(0.2), "Arc weights of a scenario are scaled by factors in [1 - spread, 1 + spread].")
+                                  ("scenario-seed", po::value<unsigned>(&opt.scenario_seed)->default_value(1), "Seed of the scenario weights.")
+                                  ("robust", po::value<string>(&opt.robust)->default_value("expected"), "Rank by the 'expected' or 'worst' burned nodes over the scenarios.")
+                                  ("evaluate", po::value<string>(&opt.evaluate)->default_value(""), "Only score the allocation of this solution file in every scenario.");
+    general.add(scenario_options);
     po::options_description beams("Beam Search");
     beams.add_options()("p", po::value<double>(&opt.p)->default_value(0.5), "Probability of picking an element of N.")
                        ("beta", po::value<unsigned>(&opt.beta)->default_value(50), "Number of starting nodes at each level.")
                        ("eta", po::value<unsigned>(&opt.eta)->default_value(70), "Number of expansions.")
                        ("c", po::value<unsigned>(&opt.c)->default_value(30), "Multiplier for the number of iterations performed by Step.")
                        ("phat", po::value<double>(&opt.phat)->default_value(0.4), "Transition instant as a percentage of the free burning time.")
-                       ("zmax", po::value<unsigned>(&opt.zmax)->default_value(3), "Maximum value for z.");
+                       ("zmax", po::value<unsigned>(&opt.zmax)->default_value(3), "Maximum value for z.")
+                       ("target-iters", po::value<unsigned>(&opt.target_iterations)->default_value(0), "Scale beta, eta and c after every iteration so that about this many iterations fit into the time limit (0 = off).");
     general.add(beams);
     po::positional_options_description pod;
     pod.add("instance", 1);
@@ -56,58 +108,305 @@ int main(int argc, char *argv[]) {
         cout << general << endl;
         return 0;
     }
+    if (opt.serve) {
+        // Requests default to these values; the time limit defaults to one second
+        json defaults = {{"seed", opt.seed}, {"timelimit", vm["timelimit"].defaulted() ? 1.0 : opt.timelimit},
+                         {"maxiter", opt.max_iterations}, {"target", opt.target}, {"p", opt.p}, {"phat", opt.phat},
+                         {"beta", opt.beta}, {"eta", opt.eta}, {"zmax", opt.zmax}, {"c", opt.c}, {"bounded", opt.bounded}};
+        Server server(defaults, opt.workers);
+        return server.run(opt.socket);
+    }
     if (!vm.count("instance")) {
         cerr << "Please provide an input instance." << endl;
         cout << general << endl;
         return 1;
     }
+    if (opt.resume && opt.checkpoint.empty()) {
+        cerr << "--resume needs a --checkpoint file." << endl;
+        return 1;
+    }
+    if (opt.robust != "expected" && opt.robust != "worst") {
+        cerr << "--robust must be 'expected' or 'worst'." << endl;
+        return 1;
+    }
+    if (!opt.evaluate.empty() && opt.scenarios == 0) {
+        cerr << "--evaluate needs --scenarios." << endl;
+        return 1;
+    }
     string base_filename = opt.instance.substr(opt.instance.find_last_of("/") + 1);
     string::size_type const p(base_filename.find_last_of('.'));
     string instance_without_extension = base_filename.substr(0, p);  
     
     // 2) Load instance
     Instance I;
-    I.read_instance(opt.instance);
+    try {
+        I.read_instance(opt.instance);
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    unique_ptr<Scenarios> scenarios;
+    Robust robust = opt.robust == "worst" ? Robust::WORST : Robust::EXPECTED;
+    if (opt.scenarios > 0)
+        scenarios = make_unique<Scenarios>(I, opt.scenarios, opt.spread, opt.scenario_seed);
 
-    // 3) Create algorithm
-    Algorithm alg (I, opt.seed, opt.p, opt.phat, opt.beta, opt.eta, opt.zmax, opt.c);
+    // Scores a fixed allocation in every scenario instead of searching
+    if (!opt.evaluate.empty()) {
+        Solution sol(opt.evaluate, I);
+        ScenarioEvaluator evaluator;
+        evaluator.attach(I, scenarios.get());
+        const ScenarioScore& score = evaluator.evaluate(sol.has_resource);
+        json report = {{"instance", instance_without_extension}, {"scenarios", opt.scenarios},
+                       {"expected", double(score.burned_sum) / opt.scenarios}, {"worst", score.burned_worst},
+                       {"expected_time_to_survival", double(score.tts_sum) / opt.scenarios}, {"worst_time_to_survival", score.tts_worst},
+                       {"burned", score.burned}, {"time_to_survival", score.time_to_survival}};
+        cout << report.dump() << endl;
+        return 0;
+    }
+
+    // 3) Create algorithms
+    vector<unique_ptr<Algorithm>> algs;
+    for (unsigned k = 0; k < max(opt.portfolio, 1u); k++) {
+        algs.emplace_back(make_unique<Algorithm>(I, opt.seed + k, opt.p, opt.phat, opt.beta, opt.eta, opt.zmax, opt.c, opt.threads, opt.bounded));
+        if (scenarios)
+            algs.back()->set_scenarios(scenarios.get(), robust);
+        algs.back()->set_table(size_t(opt.table_memory) << 20);
+        algs.back()->set_trial_parallel(opt.trial_parallel);
+    }
+    Incumbent incumbent(I);
+
+    // Warm start: only the instants after the first change of the schedule are re-planned
+    if (!opt.warmstart.empty()) {
+        Solution previous(opt.warmstart, I);
+        unsigned levels = kept_levels(I, previous.allocation, opt.replan_from);
+        Verifier verifier(I);
+        string error;
+        for (auto& alg : algs)
+            if (!fix_levels(*alg, I, previous.allocation, levels, verifier, error)) {
+                cerr << error << endl;
+                return 1;
+            }
+        unsigned objv = seed_incumbent(*algs[0], I, previous.allocation, incumbent, verifier);
+        if (opt.verbose)
+            cout << "Warm start: " << levels << " of " << I.R.size() << " levels kept, previous allocation "
+                 << (objv != numeric_limits<unsigned>::max() ? "has objective " + to_string(objv) : "is infeasible") << endl;
+    }
     
-    // 4) Run algorithm
-    Solution B(I);
-    Solution current(I);
-    unsigned iter = 0;
-    unsigned elapsed_time = 0;
-    bool global_optimum = false;
-    vector<tuple<unsigned, unsigned, unsigned, unsigned>> trajectory;
+    // 4) Run algorithms
+    atomic<unsigned> iter = 0;
+    atomic<unsigned> elapsed_time = 0;
+    atomic<unsigned long long int> budget = 0;
+    atomic<bool> global_optimum = false;
+    mutex io;
     steady_clock::time_point begin = steady_clock::now();
-    while (!global_optimum && elapsed_time < opt.timelimit && iter < opt.max_iterations && alg.get_budget() < opt.budget) {
-        current = alg.beam_search(B.objv);
-        iter++;
-        elapsed_time = duration_cast<seconds>(steady_clock::now() - begin).count();
-        if (current.objv < B.objv) {
-            if (opt.verbose)
-                cout << current.objv << " " << elapsed_time << " " << iter << " " << alg.get_budget() << endl;
-            B = current;
-            B.timestamp = elapsed_time;
-            B.iter = iter;
-            if(opt.target >= B.objv)
-                global_optimum = true;
-            trajectory.emplace_back(B.objv, elapsed_time, iter, alg.get_budget());
+
+    // Each search leaves its state in 'snapshots' after every iteration, so a checkpoint
+    // can be taken while the other searches of the portfolio are still running. 'parameters' holds
+    // the options that change the course of the search (not --threads or --trial-parallel)
+    json parameters = {{"instance", instance_without_extension}, {"seed", opt.seed}, {"portfolio", algs.size()},
+                       {"p", opt.p}, {"phat", opt.phat}, {"beta", opt.beta}, {"eta", opt.eta},
+                       {"zmax", opt.zmax}, {"c", opt.c}, {"bounded", opt.bounded},
+                       {"warmstart", opt.warmstart}, {"replan_from", opt.replan_from}, {"target_iters", opt.target_iterations},
+                       {"table_memory", opt.table_memory}};
+    if (scenarios)
+        parameters["scenarios"] = {{"count", opt.scenarios}, {"spread", opt.spread}, {"seed", opt.scenario_seed}, {"robust", opt.robust}};
+    vector<Algorithm::State> snapshots;
+    for (auto& alg : algs)
+        snapshots.push_back(alg->get_state());
+    vector<ParameterController> controllers(algs.size(), ParameterController(opt.beta, opt.eta, opt.c));
+    vector<double> scales(algs.size(), 1.0);
+    unsigned completed = 0;
+    unsigned last_checkpoint = 0;
+    mutex checkpoint_mutex;
+    if (opt.resume && ifstream(opt.checkpoint).good()) {
+        Checkpoint cp;
+        cp.read(opt.checkpoint);
+        if (cp.parameters != parameters) {
+            cerr << "The checkpoint was written by a run with different parameters." << endl;
+            return 1;
+        }
+        if (cp.has_incumbent) {
+            Solution sol(I);
+            algs[0]->replay(sol, cp.allocation);
+            if (sol.objv != cp.objv) {
+                cerr << "The incumbent of the checkpoint does not match the instance." << endl;
+                return 1;
+            }
+            sol.timestamp = cp.timestamp;
+            sol.iter = cp.iter;
+            incumbent.restore(sol, algs[0]->score(sol), cp.trajectory);
+            global_optimum = opt.target >= sol.objv;
         }
+        snapshots = cp.searches;
+        scales = cp.scales;
+        for (unsigned k = 0; k < algs.size(); k++) {
+            algs[k]->set_state(snapshots[k]);
+            budget += snapshots[k].budget;
+            controllers[k].set_scale(scales[k]);
+            algs[k]->set_parameters(controllers[k].beta(), controllers[k].eta(), controllers[k].c());
+        }
+        iter = completed = cp.iterations;
+        begin -= milliseconds(cp.elapsed_ms);
+        elapsed_time = last_checkpoint = cp.elapsed_ms / 1000;
     }
+    auto write_checkpoint = [&]() {
+        Checkpoint cp;
+        Solution best(I);
+        cp.parameters = parameters;
+        cp.iterations = completed;
+        cp.elapsed_ms = duration_cast<milliseconds>(steady_clock::now() - begin).count();
+        cp.searches = snapshots;
+        cp.scales = scales;
+        incumbent.snapshot(best, cp.trajectory);
+        cp.has_incumbent = best.objv != numeric_limits<unsigned>::max();
+        cp.objv = best.objv;
+        cp.timestamp = best.timestamp;
+        cp.iter = best.iter;
+        cp.allocation = best.allocation;
+        cp.write(opt.checkpoint);
+    };
+    run_deadline.set(begin + duration_cast<steady_clock::duration>(duration<double>(opt.timelimit)));
+    for (auto& alg : algs)
+        alg->set_deadline(&run_deadline);
+    if (!opt.checkpoint.empty())
+        signal(SIGTERM, request_stop);
+    unique_ptr<StreamWriter> stream;
+    if (!opt.stream.empty())
+        stream = make_unique<StreamWriter>(opt.stream);
+
+    auto search = [&](unsigned k) {
+        Algorithm& alg = *algs[k];
+        Solution current(I);
+        Verifier verifier(I);
+        unsigned long long int counted = alg.get_budget();
+        while (!global_optimum && !stop_requested && !run_deadline.expired() && budget < opt.budget) {
+            unsigned it = ++iter;
+            if (it > opt.max_iterations) {
+                iter--;
+                break;
+            }
+            steady_clock::time_point started = steady_clock::now();
+            current = alg.beam_search(incumbent.bkv());
+            if (stop_requested && alg.cancelled()) {
+                // Cut short by SIGTERM: dropped, so --resume runs it again from the last snapshot
+                iter--;
+                break;
+            }
+            if (opt.target_iterations > 0 && !alg.cancelled()) {
+                // Iterations still to run by this search, shared with the rest of the portfolio
+                unsigned left = opt.target_iterations > it ? opt.target_iterations - it : 1;
+                left = max(1u, (left + unsigned(algs.size()) - 1) / unsigned(algs.size()));
+                ParameterController& controller = controllers[k];
+                controller.update(duration<double>(steady_clock::now() - started).count(), run_deadline.remaining() / left);
+                alg.set_parameters(controller.beta(), controller.eta(), controller.c());
+            }
+            budget += alg.get_budget() - counted;
+            counted = alg.get_budget();
+            unsigned et = duration_cast<seconds>(steady_clock::now() - begin).count();
+            elapsed_time = max(elapsed_time.load(), et);
+            if (incumbent.update(current, alg.score(current), et, it, budget)) {
+                if (opt.verify) {
+                    alg.complete_fire_path(current);
+                    if (!verifier.check(current)) {
+                        cerr << "Iteration " << it << ": " << verifier.error() << endl;
+                        exit(1);
+                    }
+                }
+                if (stream) {
+                    // The copy is formatted by the writer thread; it only refers to the instance,
+                    // which outlives the writer (see below)
+                    current.timestamp = et;
+                    current.iter = it;
+                    double time = duration<double>(steady_clock::now() - begin).count();
+                    stream->post([sol = current, time, it, b = budget.load(), bounded = opt.bounded, compact = opt.compact](ostream& out) mutable {
+                        if (bounded && !compact)
+                            sol.rebuild_fire_path();
+                        json line = sol.to_json(compact);
+                        line["time"] = time;
+                        line["iter"] = it;
+                        line["budget"] = b;
+                        out << line.dump() << '\n';
+                    });
+                }
+                if (opt.verbose) {
+                    lock_guard<mutex> lock(io);
+                    cout << current.objv << " " << et << " " << it << " " << budget << endl;
+                }
+                if(opt.target >= current.objv)
+                    global_optimum = true;
+            }
+            if (!opt.checkpoint.empty()) {
+                lock_guard<mutex> lock(checkpoint_mutex);
+                snapshots[k] = alg.get_state();
+                scales[k] = controllers[k].scale();
+                completed++;
+                if (et >= last_checkpoint + opt.checkpoint_interval) {
+                    write_checkpoint();
+                    last_checkpoint = et;
+                }
+            }
+        }
+    };
+    vector<thread> searches;
+    for (unsigned k = 1; k < algs.size(); k++)
+        searches.emplace_back([&, k] { search(k); });
+    search(0);
+    for (thread& t : searches)
+        t.join();
+    // Writes the pending lines while the instance is still alive
+    stream.reset();
+    if (stop_requested) {
+        write_checkpoint();
+        cerr << "Stopped by SIGTERM; run again with --resume to continue from " << opt.checkpoint << endl;
+        return 0;
+    }
+    Solution& B = incumbent.best();
+    algs[0]->complete_fire_path(B);
 
     // 5) Save best solution
     if (opt.save) {
         ofstream outfile("Sol_" + instance_without_extension + ".json");
-        B.write_solution(outfile);
+        B.write_solution(outfile, opt.compact);
     }
 
-    // 6) Check solution feasibility
+    // 6) Write profiling report
+    if (!opt.profile.empty()) {
+        Profile profile;
+        for (auto& alg : algs)
+            profile.merge(alg->get_profile());
+        json report = profile.to_json();
+        report["instance"] = instance_without_extension;
+        report["iterations"] = iter.load();
+        report["budget"] = budget.load();
+        ofstream outfile(opt.profile);
+        outfile << report.dump(4) << endl;
+    }
+
+    // 7) Check solution feasibility
     check_feasibility(B);
+    if (opt.table_memory > 0 && opt.verbose) {
+        TranspositionTable::Stats stats;
+        for (auto& alg : algs)
+            stats.merge(alg->get_table_stats());
+        cout << "Transposition table: " << stats.hits << "/" << stats.lookups << " trials and " << stats.reused << "/" << stats.survivors
+             << " beam members reused, " << stats.entries << " entries (" << (stats.bytes >> 20) << " MB), " << stats.evictions << " evictions" << endl;
+    }
+    if (opt.target_iterations > 0 && opt.verbose)
+        for (unsigned k = 0; k < controllers.size(); k++)
+            cout << "Search " << k << " ended with beta " << controllers[k].beta() << ", eta " << controllers[k].eta()
+                 << ", c " << controllers[k].c() << endl;
+    if (scenarios && opt.verbose) {
+        ScenarioEvaluator evaluator;
+        evaluator.attach(I, scenarios.get());
+        const ScenarioScore& score = evaluator.evaluate(B.has_resource);
+        cout << "Burned nodes over " << opt.scenarios << " scenarios: expected " << double(score.burned_sum) / opt.scenarios
+             << ", worst " << score.burned_worst << endl;
+    }
 
-    // 7) Print results
+    // 8) Print results; with scenarios the objective and the trajectory are both the robust score
     string traj = "\"[";
-    for(const auto& [obj, et, i, b] : trajectory)
+    for(const auto& [obj, et, i, b] : incumbent.trajectory())
         traj = traj + "(" +  to_string(obj) + "," + to_string(et) + "," + to_string(i) + "," + to_string(b) + "), ";
     traj.pop_back();traj.pop_back();
     traj = traj + "]\"";
@@ -119,11 +418,11 @@ int main(int argc, char *argv[]) {
          << opt.eta << ","
          << opt.zmax << ","
          << opt.c << ","
-         << B.objv << ","
+         << incumbent.best_score() << ","
          << B.timestamp << ","
          << B.iter << ","
          << iter << ","
          << elapsed_time << "," 
-         << alg.get_budget() << ","
+         << budget << ","
          << traj << endl;
 }
\ No newline at end of file
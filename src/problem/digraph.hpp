@@ -4,6 +4,9 @@
 #include <limits>
 #include <map>
 #include <regex>
+#include <span>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 using namespace std;
@@ -12,76 +15,111 @@ using namespace std;
 typedef pair<unsigned, unsigned> COORD;
 typedef unsigned NODE_ID;
 
-struct Edge {
-  unsigned id, source, destination, weight;
-  Edge(unsigned _id, NODE_ID _s, NODE_ID _d, unsigned _w)
-      : id(_id), source(_s), destination(_d), weight(_w) {}
+struct CoordHash {
+  size_t operator()(const COORD& c) const { return (size_t(c.first) << 32) ^ c.second; }
 };
 
-struct Node {
-  unsigned id;
-  vector<Edge*> incoming;
-  vector<Edge*> outgoing;
-  Node() : id(){};
-  Node(NODE_ID nid)
-      : id(nid), incoming(vector<Edge*>()), outgoing(vector<Edge*>()) {}
-  void add_incoming_edge(Edge* e) { incoming.push_back(e); }
-  void add_outgoing_edge(Edge* e) { outgoing.push_back(e); }
+// Arc as seen from one of its endpoints: 'node' is the destination of an
+// outgoing arc and the source of an incoming arc.
+struct Arc {
+  NODE_ID node;
+  unsigned weight;
 };
 
+// Compressed sparse row graph. Arcs are staged by add_edge and laid out
+// contiguously by build(), which must be called before any arc is queried.
 class Digraph {
 
 private:
-  unsigned edge_id_counter = 0;
   NODE_ID node_id_counter = 0;
   vector<COORD> id_to_coord;
-  map<COORD, NODE_ID> coord_to_id;
-  vector<Node> nodes;
-  vector<Edge*> edges;
+  unordered_map<COORD, NODE_ID, CoordHash> coord_to_id;
+  vector<tuple<NODE_ID, NODE_ID, unsigned>> staged_arcs;
+  vector<unsigned> out_offset;
+  vector<unsigned> in_offset;
+  vector<Arc> out_arcs;
+  vector<Arc> in_arcs;
 
 
 public:
   Digraph() = default;
-
-  ~Digraph() {
-    for (Edge* e : edges) delete e;
-  }
   
   // TODO: check for repeated nodes
   void add_node(COORD coord) {
     id_to_coord.push_back(coord);
     coord_to_id[coord] = node_id_counter;
-    nodes.push_back(Node(node_id_counter));
     node_id_counter++;
   }
 
   void add_edge(COORD source, COORD destination, unsigned weight) {
-    NODE_ID s = coord_to_id[source];
-    NODE_ID d = coord_to_id[destination];
-    Edge* e = new Edge(edge_id_counter++, s, d, weight);
-    edges.push_back(e);
-    nodes[s].add_outgoing_edge(e);
-    nodes[d].add_incoming_edge(e);
+    staged_arcs.emplace_back(coord_to_id[source], coord_to_id[destination], weight);
+  }
+
+  // Counting sort of the staged arcs by source and by destination. Arcs keep
+  // their insertion order within a node.
+  void build() {
+    unsigned n = id_to_coord.size();
+    out_offset.assign(n + 1, 0);
+    in_offset.assign(n + 1, 0);
+    for (const auto& [s, d, w] : staged_arcs) {
+      out_offset[s + 1]++;
+      in_offset[d + 1]++;
+    }
+    for (unsigned u = 0; u < n; u++) {
+      out_offset[u + 1] += out_offset[u];
+      in_offset[u + 1] += in_offset[u];
+    }
+    out_arcs.resize(staged_arcs.size());
+    in_arcs.resize(staged_arcs.size());
+    vector<unsigned> out_pos(out_offset.begin(), out_offset.end() - 1);
+    vector<unsigned> in_pos(in_offset.begin(), in_offset.end() - 1);
+    for (const auto& [s, d, w] : staged_arcs) {
+      out_arcs[out_pos[s]++] = {d, w};
+      in_arcs[in_pos[d]++] = {s, w};
+    }
+    staged_arcs = vector<tuple<NODE_ID, NODE_ID, unsigned>>();
+  }
+
+  // Adopts an already laid out graph, e.g. one read from a binary instance file
+  void assign(vector<COORD> coords, vector<unsigned> _out_offset, vector<Arc> _out_arcs, vector<unsigned> _in_offset, vector<Arc> _in_arcs) {
+    id_to_coord = std::move(coords);
+    node_id_counter = id_to_coord.size();
+    coord_to_id.clear();
+    coord_to_id.reserve(id_to_coord.size());
+    for (NODE_ID u = 0; u < id_to_coord.size(); u++)
+      coord_to_id[id_to_coord[u]] = u;
+    out_offset = std::move(_out_offset);
+    out_arcs = std::move(_out_arcs);
+    in_offset = std::move(_in_offset);
+    in_arcs = std::move(_in_arcs);
   }
 
-  const vector<Edge*> &get_outgoing_edges(NODE_ID node_id) {
-    return nodes[node_id].outgoing;
+  const vector<unsigned>& get_outgoing_offsets() const { return out_offset; }
+
+  const vector<Arc>& get_outgoing_arc_array() const { return out_arcs; }
+
+  const vector<unsigned>& get_incoming_offsets() const { return in_offset; }
+
+  const vector<Arc>& get_incoming_arc_array() const { return in_arcs; }
+
+  inline span<const Arc> get_outgoing_arcs(NODE_ID node_id) const {
+    return {out_arcs.data() + out_offset[node_id], out_arcs.data() + out_offset[node_id + 1]};
   }
 
-  const vector<Edge*> &get_incoming_edges(NODE_ID node_id) {
-    return nodes[node_id].incoming;
+  inline span<const Arc> get_incoming_arcs(NODE_ID node_id) const {
+    return {in_arcs.data() + in_offset[node_id], in_arcs.data() + in_offset[node_id + 1]};
   }
 
   unsigned get_edge_cost(NODE_ID pred, NODE_ID succ){
-    for(const Edge* e : nodes[pred].outgoing)
-      if(e->destination == succ) return e->weight;
+    for(const Arc& e : get_outgoing_arcs(pred))
+      if(e.node == succ) return e.weight;
     cerr << "Node " << get_node_signature(pred) << " is not a neighbor of node " << get_node_signature(succ) << endl;
     exit(1);
   }
 
-  unsigned get_number_of_nodes() { return nodes.size(); }
+  unsigned get_number_of_nodes() { return id_to_coord.size(); }
 
-  unsigned get_number_of_edges() { return edges.size(); }
+  unsigned get_number_of_edges() { return out_arcs.size(); }
 
   COORD get_node_coord(NODE_ID nid) { return id_to_coord[nid];}
 
@@ -97,7 +135,15 @@ public:
 
   string get_node_signature(NODE_ID id) {
     COORD c = id_to_coord[id];
-    return "(" + to_string(c.first) + "," + to_string(c.second) + ")";
+    // Appended piecewise: "(" + to_string(..) trips a false -Wrestrict in GCC 12 once inlined
+    string signature;
+    signature.reserve(24);
+    signature += '(';
+    signature += to_string(c.first);
+    signature += ',';
+    signature += to_string(c.second);
+    signature += ')';
+    return signature;
   }
 };
 
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <fstream>
-#include <regex>
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
 using namespace std;
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
@@ -15,22 +24,70 @@ using namespace boost;
 
 #include "digraph.hpp"
 
+/*
+    Binary instance format (native-endian uint32 fields unless noted):
+        header          BinaryHeader
+        coordinates     n x (x, y)
+        ignitions       n_ignitions x (node id, start time)
+        resources       n_resources x (instant, quantity)
+        outgoing arcs   (n+1) offsets, m x (destination, weight)
+        incoming arcs   (n+1) offsets, m x (source, weight)
+        N               (n+1) offsets, n_N node ids
+        Nstar           (n+1) offsets, n_Nstar node ids
+*/
+constexpr char BINARY_MAGIC[8] = {'F', 'I', 'R', 'E', 'B', 'I', 'N', '\0'};
+constexpr uint32_t BINARY_VERSION = 2;  // Files of other versions are rejected; fire-convert rewrites them
+
+// Start time of a node that is not an ignition (equal to INF in the algorithm)
+constexpr unsigned NO_IGNITION = numeric_limits<int>::max();
+
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t n, m, H, Delta;
+  uint32_t n_ignitions, n_resources, n_N, n_Nstar;
+};
+
 struct Instance {
   unsigned H;                  // Optimization horizon
   unsigned n;                  // Number of nodes
-  unsigned ign;                // Ignition node
+  vector<unsigned> ignitions;  // Ignition nodes
+  vector<unsigned> ignition_time; // Start time of the fire at each node, NO_IGNITION for non-ignitions
   unsigned Delta;              // Delay
 
   vector<pair<unsigned, unsigned>> R; // Number of resources that become available at instant k
   vector<unsigned> T; // Time instants at which resources are available
   Digraph G; // Graph
 
-  vector<set<NODE_ID>> N; // Immediate neighborhood
-  vector<set<NODE_ID>> Nstar; // Extended neighborhood
+  vector<vector<NODE_ID>> N; // Immediate neighborhood (sorted)
+  vector<vector<NODE_ID>> Nstar; // Extended neighborhood (sorted)
+  vector<uint64_t> zobrist; // Random key per node; a set of resources is fingerprinted by the XOR of its keys
+
+  // Ignitions at the same node are merged, keeping the earliest start time
+  void set_ignitions(const vector<pair<unsigned, unsigned>>& starts) {
+      ignitions.clear();
+      ignition_time.assign(n, NO_IGNITION);
+      for (auto const& [node, time] : starts) {
+        if (node >= n)
+          throw runtime_error("Ignition node " + to_string(node) + " does not exist.");
+        if (ignition_time[node] == NO_IGNITION)
+          ignitions.push_back(node);
+        ignition_time[node] = min(ignition_time[node], time);
+      }
+      if (ignitions.empty())
+        throw runtime_error("The instance has no ignition.");
+  }
+
+  void build_zobrist_keys() {
+      mt19937_64 gen(n);
+      zobrist = vector<uint64_t>(n);
+      for(uint64_t& key : zobrist)
+        key = gen();
+  }
 
   void build_neighborhoods() {
-      N = vector<set<NODE_ID>>(G.get_number_of_nodes());
-      Nstar = vector<set<NODE_ID>>(G.get_number_of_nodes());
+      N = vector<vector<NODE_ID>>(G.get_number_of_nodes());
+      Nstar = vector<vector<NODE_ID>>(G.get_number_of_nodes());
       for(const COORD& n_c : G.get_list_of_coords()) {
         unsigned nid = G.get_node_id(n_c);
         unsigned x = n_c.first, y = n_c.second;
@@ -40,8 +97,8 @@ struct Instance {
         COORD n4 = {x, y + 1};
         for(COORD ni : {n1, n2, n3, n4})
           if(ni != n_c && G.is_valid(ni)) {
-            N[nid].insert(G.get_node_id(ni));
-            Nstar[nid].insert(G.get_node_id(ni));
+            N[nid].push_back(G.get_node_id(ni));
+            Nstar[nid].push_back(G.get_node_id(ni));
           }
         COORD n5 = {x == 0 ? 0 : x - 1, y == 0 ? 0 : y - 1};
         COORD n6 = {x == 0 ? 0 : x - 1, y + 1};
@@ -49,16 +106,31 @@ struct Instance {
         COORD n8 = {x + 1, y + 1};
         for(COORD ni : {n5, n6, n7, n8})
           if(ni != n_c && G.is_valid(ni)) 
-            Nstar[nid].insert(G.get_node_id(ni));   
+            Nstar[nid].push_back(G.get_node_id(ni));   
+        // Clamped coordinates at the border may repeat a neighbor
+        for(vector<NODE_ID>* nb : {&N[nid], &Nstar[nid]}) {
+          sort(nb->begin(), nb->end());
+          nb->erase(unique(nb->begin(), nb->end()), nb->end());
+        }
     } 
   }
 
+  // Reads a JSON instance, or a binary one if the file starts with BINARY_MAGIC
   void read_instance(const string &instance_file) {
+    ifstream f(instance_file, ios::binary);
+    if (!f.good())
+      throw runtime_error("Could not open instance specification file: " + instance_file);
+    char magic[sizeof(BINARY_MAGIC)] = {};
+    f.read(magic, sizeof(magic));
+    f.close();
+    if (memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0)
+      read_binary_instance(instance_file);
+    else
+      read_json_instance(instance_file);
+  }
+
+  void read_json_instance(const string &instance_file) {
     ifstream f(instance_file);
-    if (!f.good()) {
-      cerr << "Could not open instance specification file: " << instance_file << endl;
-      exit(1);
-    }
     json instance = json::parse(f);
     f.close();
 
@@ -88,42 +160,222 @@ struct Instance {
     }
     n = G.get_number_of_nodes();
 
-    // Ignition node
-    unsigned ign_x = instance["Ignitions"].at(0).at(0).get<unsigned>();
-    unsigned ign_y = instance["Ignitions"].at(0).at(1).get<unsigned>();
-    ign = G.get_node_id(MAKE_COORD(ign_x, ign_y));
+    // Ignitions, as [i, j] (ignited at 0) or [i, j, start time]
+    vector<pair<unsigned, unsigned>> starts;
+    for (const auto &ignition : instance["Ignitions"]) {
+      COORD c = MAKE_COORD(ignition.at(0).get<unsigned>(), ignition.at(1).get<unsigned>());
+      if (!G.is_valid(c))
+        throw runtime_error("Ignition (" + to_string(c.first) + ", " + to_string(c.second) + ") is not a node of the landscape.");
+      starts.emplace_back(G.get_node_id(c), ignition.size() > 2 ? ignition.at(2).get<unsigned>() : 0);
+    }
+    set_ignitions(starts);
 
-    // Edges
-    regex rgx("\\((-?\\d+), (-?\\d+)\\)");
+    // Edges, keyed by strings of the form "((i, j), (k, l))"
+    vector<int> values;
     for (const auto &edge : instance["Arcs"].items()) {
-      const string coords = edge.key();
+      const string& coords = edge.key();
       unsigned weight = edge.value();
 
-      vector<int> values;
-      sregex_iterator iterator(coords.begin(), coords.end(), rgx);
-      sregex_iterator endIterator;
-      while (iterator != endIterator) {
-        smatch match = *iterator;
-        int firstValue = stoi(match[1]);
-        int secondValue = stoi(match[2]);
-        values.push_back(firstValue);
-        values.push_back(secondValue);
-        ++iterator;
+      values.clear();
+      const char* c = coords.c_str();
+      while (*c) {
+        if (*c == '-' || isdigit(*c)) {
+          char* end;
+          values.push_back(strtol(c, &end, 10));
+          c = end;
+        } else
+          c++;
       }
       COORD c1 = MAKE_COORD(values[0], values[1]);
       COORD c2 = MAKE_COORD(values[2], values[3]);
       G.add_edge(c1, c2, weight);
     }
+    G.build();
 
     build_neighborhoods();
+    build_zobrist_keys();
+  }
+
+  // The file is mapped and copied into the arrays of the instance, which own their memory;
+  // every count, offset and node id is checked first, so a corrupt file is rejected
+  void read_binary_instance(const string &instance_file) {
+    int fd = open(instance_file.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error("Could not open instance specification file: " + instance_file);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw runtime_error("Could not open instance specification file: " + instance_file);
+    }
+    size_t size = st.st_size;
+    void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED)
+      throw runtime_error("Could not map instance specification file: " + instance_file);
+    struct Mapping {
+      void* data;
+      size_t size;
+      ~Mapping() { munmap(data, size); }
+    } mapping{data, size};
+    auto corrupt = [&](const string& what) {
+      return runtime_error("Corrupt binary instance file " + instance_file + ": " + what);
+    };
+
+    const char* cursor = static_cast<const char*>(data);
+    const char* end = cursor + size;
+    auto take = [&](void* dst, size_t bytes) {
+      if (size_t(end - cursor) < bytes)
+        throw runtime_error("Truncated binary instance file: " + instance_file);
+      memcpy(dst, cursor, bytes);
+      cursor += bytes;
+    };
+    auto take_vector = [&]<typename V>(V& v, size_t count) {
+      v.resize(count);
+      take(v.data(), count * sizeof(typename V::value_type));
+    };
+
+    BinaryHeader h;
+    take(&h, sizeof(h));
+    if (h.version != BINARY_VERSION)
+      throw runtime_error("Unsupported binary instance version " + to_string(h.version) + " in " + instance_file);
+    size_t words = 2 * size_t(h.n) + 2 * size_t(h.n_ignitions) + 2 * size_t(h.n_resources) +
+                   4 * (size_t(h.n) + 1) + 4 * size_t(h.m) + size_t(h.n_N) + size_t(h.n_Nstar);
+    if (size != sizeof(h) + words * sizeof(uint32_t))
+      throw runtime_error("Truncated binary instance file: " + instance_file);
+    n = h.n;
+    H = h.H;
+    Delta = h.Delta;
+
+    vector<uint32_t> raw_coords, raw_ignitions, raw_resources;
+    take_vector(raw_coords, 2 * size_t(n));
+    take_vector(raw_ignitions, 2 * size_t(h.n_ignitions));
+    take_vector(raw_resources, 2 * size_t(h.n_resources));
+    vector<unsigned> out_offset, in_offset;
+    vector<Arc> out_arcs, in_arcs;
+    take_vector(out_offset, n + 1);
+    take_vector(out_arcs, h.m);
+    take_vector(in_offset, n + 1);
+    take_vector(in_arcs, h.m);
+    vector<unsigned> N_offset, N_ids, Nstar_offset, Nstar_ids;
+    take_vector(N_offset, n + 1);
+    take_vector(N_ids, h.n_N);
+    take_vector(Nstar_offset, n + 1);
+    take_vector(Nstar_ids, h.n_Nstar);
+
+    // Offsets must run from 0 to the number of entries without decreasing, and ids must be nodes
+    auto check_offsets = [&](const vector<unsigned>& offset, size_t count, const char* what) {
+      if (offset[0] != 0 || offset[n] != count)
+        throw corrupt(string(what) + " offsets do not span " + to_string(count) + " entries");
+      for (unsigned u = 0; u < n; u++)
+        if (offset[u] > offset[u + 1])
+          throw corrupt(string(what) + " offsets decrease at node " + to_string(u));
+    };
+    auto check_node = [&](unsigned id, const char* what) {
+      if (id >= n)
+        throw corrupt(string(what) + " refers to node " + to_string(id) + " of " + to_string(n));
+    };
+    check_offsets(out_offset, h.m, "Outgoing arc");
+    check_offsets(in_offset, h.m, "Incoming arc");
+    check_offsets(N_offset, h.n_N, "Neighborhood");
+    check_offsets(Nstar_offset, h.n_Nstar, "Extended neighborhood");
+    for (const Arc& a : out_arcs)
+      check_node(a.node, "An outgoing arc");
+    for (const Arc& a : in_arcs)
+      check_node(a.node, "An incoming arc");
+    for (unsigned id : N_ids)
+      check_node(id, "A neighborhood");
+    for (unsigned id : Nstar_ids)
+      check_node(id, "An extended neighborhood");
+
+    vector<COORD> coords(n);
+    for (unsigned u = 0; u < n; u++)
+      coords[u] = MAKE_COORD(raw_coords[2 * u], raw_coords[2 * u + 1]);
+    G = Digraph();
+    G.assign(std::move(coords), std::move(out_offset), std::move(out_arcs), std::move(in_offset), std::move(in_arcs));
+
+    vector<pair<unsigned, unsigned>> starts;
+    for (unsigned i = 0; i < h.n_ignitions; i++)
+      starts.emplace_back(raw_ignitions[2 * i], raw_ignitions[2 * i + 1]);
+    set_ignitions(starts);
+    R = vector<pair<unsigned, unsigned>>();
+    T = vector<unsigned>();
+    for (unsigned r = 0; r < h.n_resources; r++) {
+      R.emplace_back(raw_resources[2 * r], raw_resources[2 * r + 1]);
+      T.push_back(raw_resources[2 * r]);
+    }
+
+    N = vector<vector<NODE_ID>>(n);
+    Nstar = vector<vector<NODE_ID>>(n);
+    for (unsigned u = 0; u < n; u++) {
+      N[u].assign(N_ids.begin() + N_offset[u], N_ids.begin() + N_offset[u + 1]);
+      Nstar[u].assign(Nstar_ids.begin() + Nstar_offset[u], Nstar_ids.begin() + Nstar_offset[u + 1]);
+    }
+    build_zobrist_keys();
+  }
+
+  void write_binary_instance(const string &instance_file) {
+    ofstream f(instance_file, ios::binary);
+    if (!f.good())
+      throw runtime_error("Could not create file: " + instance_file);
+    auto put = [&]<typename V>(const V& v) {
+      f.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(typename V::value_type));
+    };
+    auto flatten = [](const vector<vector<NODE_ID>>& lists, vector<unsigned>& offsets, vector<unsigned>& ids) {
+      offsets = {0};
+      for (const vector<NODE_ID>& l : lists) {
+        ids.insert(ids.end(), l.begin(), l.end());
+        offsets.push_back(ids.size());
+      }
+    };
+
+    vector<unsigned> N_offset, N_ids, Nstar_offset, Nstar_ids;
+    flatten(N, N_offset, N_ids);
+    flatten(Nstar, Nstar_offset, Nstar_ids);
+    vector<uint32_t> raw_coords, raw_ignitions, raw_resources;
+    for (const COORD& c : G.get_list_of_coords()) {
+      raw_coords.push_back(c.first);
+      raw_coords.push_back(c.second);
+    }
+    for (unsigned ign : ignitions) {
+      raw_ignitions.push_back(ign);
+      raw_ignitions.push_back(ignition_time[ign]);
+    }
+    for (const auto& [instant, quantity] : R) {
+      raw_resources.push_back(instant);
+      raw_resources.push_back(quantity);
+    }
+
+    BinaryHeader h;
+    memcpy(h.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    h.version = BINARY_VERSION;
+    h.n = n;
+    h.m = G.get_number_of_edges();
+    h.H = H;
+    h.Delta = Delta;
+    h.n_ignitions = ignitions.size();
+    h.n_resources = R.size();
+    h.n_N = N_ids.size();
+    h.n_Nstar = Nstar_ids.size();
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    put(raw_coords);
+    put(raw_ignitions);
+    put(raw_resources);
+    put(G.get_outgoing_offsets());
+    put(G.get_outgoing_arc_array());
+    put(G.get_incoming_offsets());
+    put(G.get_incoming_arc_array());
+    put(N_offset);
+    put(N_ids);
+    put(Nstar_offset);
+    put(Nstar_ids);
   }
 
-  const vector<Edge*> &get_outgoing_edges(NODE_ID node_id) {
-    return G.get_outgoing_edges(node_id);
+  inline span<const Arc> get_outgoing_arcs(NODE_ID node_id) const {
+    return G.get_outgoing_arcs(node_id);
   }
 
-  const vector<Edge*> &get_incoming_edges(NODE_ID node_id) {
-    return G.get_incoming_edges(node_id);
+  inline span<const Arc> get_incoming_arcs(NODE_ID node_id) const {
+    return G.get_incoming_arcs(node_id);
   }
 
   unsigned get_number_of_edges() { return G.get_number_of_edges(); }
@@ -139,11 +391,11 @@ struct Instance {
       return *upper_bound(T.begin(), T.end(), t);
   }
 
-  const set<NODE_ID>& get_extended_neighborhood(NODE_ID nid){
+  const vector<NODE_ID>& get_extended_neighborhood(NODE_ID nid){
     return Nstar[nid];
   }
 
-  const set<NODE_ID>& get_neighborhood(NODE_ID nid){
+  const vector<NODE_ID>& get_neighborhood(NODE_ID nid){
     return N[nid];
   }
 
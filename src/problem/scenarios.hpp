@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+using namespace std;
+
+#include "instance.hpp"
+
+// Scenarios are evaluated in groups of this many lanes (8 x uint32 fill one 256-bit vector)
+constexpr unsigned SCENARIO_LANES = 8;
+
+/*
+    Perturbed arc weights for robust scoring, e.g. wind and fuel moisture
+    uncertainty. Scenario 0 keeps the nominal weights; in every other
+    scenario each arc weight is scaled by its own factor drawn uniformly from
+    [1 - spread, 1 + spread] (and is at least 1). The weights of an arc are
+    stored scenario-major, one lane per scenario, in the order of the CSR
+    outgoing arcs. The number of lanes is rounded up to a multiple of
+    SCENARIO_LANES; padding lanes have weight H, so fire never spreads in
+    them before the horizon.
+*/
+class Scenarios {
+   private:
+    unsigned _count;
+    unsigned _width;
+    vector<unsigned> _weight;
+
+   public:
+    Scenarios(Instance& I, unsigned count, double spread, unsigned seed) : _count(count) {
+        _width = (count + SCENARIO_LANES - 1) / SCENARIO_LANES * SCENARIO_LANES;
+        const vector<Arc>& arcs = I.G.get_outgoing_arc_array();
+        _weight.assign(arcs.size() * size_t(_width), I.H);
+        mt19937 gen(seed);
+        uniform_real_distribution<double> factor(max(0.0, 1 - spread), 1 + spread);
+        for (unsigned k = 0; k < count; k++)
+            for (size_t idx = 0; idx < arcs.size(); idx++) {
+                double w = k == 0 ? arcs[idx].weight : lround(arcs[idx].weight * factor(gen));
+                _weight[idx * _width + k] = max(1.0, w);
+            }
+    }
+
+    // Number of scenarios
+    inline unsigned count() const { return _count; }
+
+    // Number of lanes per node and per arc
+    inline unsigned width() const { return _width; }
+
+    // Lanes of the outgoing arc at position 'idx' of the CSR array
+    inline const unsigned* weights(size_t idx) const { return _weight.data() + idx * _width; }
+};
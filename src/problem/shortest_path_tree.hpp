@@ -3,11 +3,10 @@
 #include <vector>
 using namespace std;
 
+// Fire path with one root per ignition; a root is its own predecessor
 typedef struct ShortestPathTree {
-    unsigned s;
     vector<unsigned> p;
     vector<unsigned> a;
-    ShortestPathTree(unsigned _s, unsigned n): s(_s), p(vector<unsigned>(n)), a(vector<unsigned>(n)){}
-    ShortestPathTree(unsigned _s): s(_s) {}
+    ShortestPathTree(unsigned n): p(vector<unsigned>(n)), a(vector<unsigned>(n)){}
     ShortestPathTree() = default;
 } ShortestPathTree;
\ No newline at end of file
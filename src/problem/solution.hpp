@@ -3,6 +3,7 @@
 #include <fstream>
 #include <limits>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <vector>
 using namespace std;
@@ -12,6 +13,7 @@ using json = nlohmann::json;
 
 #include "instance.hpp"
 #include "shortest_path_tree.hpp"
+#include "bitset.hpp"
 #include "heap.hpp"
 
 class Solution {
@@ -24,46 +26,62 @@ class Solution {
         }
         json solution = json::parse(f);
         f.close();
+        read_json(solution);
+    }
 
-        objv = solution["objv"].get<unsigned>();
+   public:
+    // Reads a solution in the format of write_solution() into a freshly constructed object
+    void read_json(json& solution) {
+        // Looking up an unknown coordinate would add it to the (possibly shared) instance
+        auto node_id = [&](const json& coord) {
+            COORD c = MAKE_COORD(coord.at(0).get<unsigned>(), coord.at(1).get<unsigned>());
+            if (!I.G.is_valid(c))
+                throw invalid_argument("Unknown node " + coord.dump());
+            return I.G.get_node_id(c);
+        };
+        objv = solution.value("objv", numeric_limits<unsigned>::max());
         for (auto entry : solution["resourceAllocation"]) {
-            unsigned i = entry.at(0).at(0).get<unsigned>();
-            unsigned j = entry.at(0).at(1).get<unsigned>();
             unsigned instant = entry.at(1).get<unsigned>();
-            unsigned n_id = I.G.get_node_id(MAKE_COORD(i, j));
+            unsigned n_id = node_id(entry.at(0));
             allocation.emplace_back(n_id, instant);
-            has_resource[n_id] = true;
+            has_resource.set(n_id);
+            fingerprint ^= I.zobrist[n_id];
             
         }
-        for (auto entry : solution["fireArrivalTime"]) {
-            unsigned i = entry.at(0).at(0).get<unsigned>();
-            unsigned j = entry.at(0).at(1).get<unsigned>();
-            unsigned instant = entry.at(1).get<unsigned>();
-            unsigned n_id = I.G.get_node_id(MAKE_COORD(i, j));
-            fire_path.a[n_id] = instant;
-        }
+        // Compact files only hold the allocation
+        if (!solution.contains("fireArrivalTime"))
+            rebuild_fire_path();
+        for (auto entry : solution["fireArrivalTime"])
+            fire_path.a[node_id(entry.at(0))] = entry.at(1).get<unsigned>();
+        for (auto entry : solution["pred"])
+            fire_path.p[node_id(entry.at(0))] = node_id(entry.at(1));
+        time_to_survival = 0;
+        for (unsigned n = 0; n < I.n; n++)
+            time_to_survival += max(int(I.H) - int(fire_path.a[n]), 0);
     }
 
-   public:
-    Solution(const string& solution_file, Instance &_I) : I(_I), fire_path(_I.ign, _I.n) {
+    Solution(const string& solution_file, Instance &_I) : I(_I), fire_path(_I.n) {
         timestamp = 0;
         iter = 0;
-        has_resource = string(I.n, false);
+        has_resource = ResourceSet(I.n);
+        fingerprint = 0;
         if(solution_file != "")
             read_solution(solution_file);
     }
     
-    Solution(Instance &_I) : I(_I), fire_path(_I.ign, I.n) {
+    Solution(Instance &_I) : I(_I), fire_path(I.n) {
         timestamp = 0;
         iter = 0;
-        has_resource = string(I.n, false);
+        has_resource = ResourceSet(I.n);
+        fingerprint = 0;
         objv = numeric_limits<unsigned>::max();
     }
 
     Instance& I;
     ShortestPathTree fire_path;
     vector<pair<unsigned, unsigned>> allocation;
-    string has_resource;
+    ResourceSet has_resource;
+    uint64_t fingerprint; // XOR of the Zobrist keys of the nodes with a resource
 
     // Statistics
     unsigned objv;
@@ -72,10 +90,10 @@ class Solution {
     unsigned time_to_survival;
   
     Solution& operator=(const Solution& other) {   
-        I = other.I;
         fire_path = other.fire_path;
         allocation = other.allocation;
         has_resource = other.has_resource;
+        fingerprint = other.fingerprint;
         objv = other.objv;
         timestamp = other.timestamp;
         iter = other.iter;
@@ -83,25 +101,56 @@ class Solution {
         return *this;
     }
 
-    void write_solution(ofstream& fout) {
+    // The compact encoding leaves out 'pred' and 'fireArrivalTime', which follow from the allocation
+    json to_json(bool compact = false) {
         json data;
         data["objv"] = objv;
         data["timestamp"] = timestamp;
-        data["pred"] = json::array();
-        data["fireArrivalTime"] = json::array();
-        data["resourceAllocation"] = json::array();
-        for (unsigned n = 0; n < I.n; n++){
-            unsigned pred_n = fire_path.p[n];
-            COORD coord_n = I.G.get_node_coord(n);
-            COORD coord_pred_n = I.G.get_node_coord(pred_n);
-            data["pred"].push_back({{coord_n.first, coord_n.second}, {coord_pred_n.first, coord_pred_n.second}});
-            data["fireArrivalTime"].push_back({{coord_n.first, coord_n.second}, fire_path.a[n]});
+        if (!compact) {
+            data["pred"] = json::array();
+            data["fireArrivalTime"] = json::array();
+            for (unsigned n = 0; n < I.n; n++){
+                unsigned pred_n = fire_path.p[n];
+                COORD coord_n = I.G.get_node_coord(n);
+                COORD coord_pred_n = I.G.get_node_coord(pred_n);
+                data["pred"].push_back({{coord_n.first, coord_n.second}, {coord_pred_n.first, coord_pred_n.second}});
+                data["fireArrivalTime"].push_back({{coord_n.first, coord_n.second}, fire_path.a[n]});
+            }
         }
+        data["resourceAllocation"] = json::array();
         for (auto const& [node, instant] : allocation){
             COORD n_coord = I.G.get_node_coord(node);
             data["resourceAllocation"].push_back({{n_coord.first, n_coord.second}, instant});
         }
-        string output_str = data.dump(4);
+        return data;
+    }
+
+    void write_solution(ostream& fout, bool compact = false) {
+        string output_str = compact ? to_json(true).dump() : to_json().dump(4);
         fout << output_str << std::endl;
     }
+
+    // Recomputes the fire path from scratch with the delays of the allocated resources
+    void rebuild_fire_path() {
+        constexpr unsigned INF = numeric_limits<int>::max();
+        Heap heap(I.n);
+        fill(fire_path.a.begin(), fire_path.a.end(), INF);
+        for (unsigned ign : I.ignitions) {
+            heap.insertElement(ign, I.ignition_time[ign]);
+            fire_path.a[ign] = I.ignition_time[ign];
+            fire_path.p[ign] = ign;
+        }
+        while (!heap.empty()) {
+            unsigned u = heap.findAndDeleteMinElement();
+            for (const Arc& e : I.get_outgoing_arcs(u)) {
+                unsigned v = e.node;
+                unsigned w = has_resource[u] ? e.weight + I.Delta : e.weight;
+                if (fire_path.a[v] > fire_path.a[u] + w) {
+                    fire_path.a[v] = fire_path.a[u] + w;
+                    fire_path.p[v] = u;
+                    heap.adjustHeap(v, fire_path.a[v]);
+                }
+            }
+        }
+    }
 };
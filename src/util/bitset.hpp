@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Set of nodes in [0, n) packed into 64-bit words, one bit per node. Copying
+// and comparing touch n / 64 words, so a beam member's resources cost 8x
+// less than with one byte per node. Bits past n are always zero, which keeps
+// comparison, count() and hash() word-wise.
+class ResourceSet {
+   private:
+    vector<uint64_t> words;
+    unsigned n = 0;
+
+   public:
+    ResourceSet(unsigned _n = 0) : words((_n + 63) / 64, 0), n(_n) {}
+
+    inline bool test(unsigned v) const { return (words[v >> 6] >> (v & 63)) & 1; }
+
+    inline bool operator[](unsigned v) const { return test(v); }
+
+    inline void set(unsigned v) { words[v >> 6] |= uint64_t(1) << (v & 63); }
+
+    inline void reset(unsigned v) { words[v >> 6] &= ~(uint64_t(1) << (v & 63)); }
+
+    void clear() { fill(words.begin(), words.end(), 0); }
+
+    inline unsigned size() const { return n; }
+
+    // Number of nodes in the set
+    unsigned count() const {
+        unsigned total = 0;
+        for (uint64_t w : words)
+            total += popcount(w);
+        return total;
+    }
+
+    // Hash of the members (FNV-1a over the words)
+    uint64_t hash() const {
+        uint64_t h = 14695981039346656037ull;
+        for (uint64_t w : words) {
+            h ^= w;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    bool operator==(const ResourceSet& other) const { return n == other.n && words == other.words; }
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+using namespace std;
+
+// Cancellation token of a search: expired() turns true at a point in time, once
+// cancel() is called or once the parent token expires, whichever comes first,
+// and then stays true. It is cheap enough to be polled once per trial and may
+// be shared by the threads of a search. cancel() only stores a lock-free atomic,
+// so it may be called from a signal handler.
+class Deadline {
+   private:
+    chrono::steady_clock::time_point _at;
+    const Deadline* _parent;
+    mutable atomic<bool> _expired;
+
+   public:
+    Deadline(chrono::steady_clock::time_point at = chrono::steady_clock::time_point::max(), const Deadline* parent = nullptr)
+        : _at(at), _parent(parent), _expired(false) {}
+
+    // Moves the point in time; must not race with expired(), and a token that has expired stays expired
+    void set(chrono::steady_clock::time_point at) { _at = at; }
+
+    void cancel() { _expired.store(true, memory_order_relaxed); }
+
+    bool expired() const {
+        if (_expired.load(memory_order_relaxed))
+            return true;
+        if (chrono::steady_clock::now() < _at && !(_parent && _parent->expired()))
+            return false;
+        _expired.store(true, memory_order_relaxed);
+        return true;
+    }
+
+    // Seconds until the point in time (negative once it has passed)
+    double remaining() const { return chrono::duration<double>(_at - chrono::steady_clock::now()).count(); }
+};
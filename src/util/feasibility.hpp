@@ -1,131 +1,119 @@
 #pragma once
 
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
 #include "solution.hpp"
-#include "heap.hpp"
 
-void dijkstra(Solution& sol){
-    constexpr int INF = numeric_limits<int>::max();
-    Instance& I = sol.I;
-    ShortestPathTree reference_fire_path = ShortestPathTree(I.ign, I.n);
-    MyHeap Q(I.n);
-    fill(reference_fire_path.a.begin(), reference_fire_path.a.end(), INF);
-    Q.insertElement(I.ign, 0);
-    reference_fire_path.a[I.ign] = 0;
-    reference_fire_path.p[I.ign] = I.ign;
-    unsigned reference_objective = 0;
-    while (!Q.empty()) {
-        unsigned u = Q.findAndDeleteMinElement();
-        unsigned du = reference_fire_path.a[u];
-        if (I.H > du)
-          reference_objective++;
-        for (Edge *e : I.get_outgoing_edges(u)) {
-            unsigned v = e->destination;
-            unsigned w = sol.has_resource[u]? e->weight + I.Delta : e->weight;
-            if (reference_fire_path.a[v] > du + w && u != v) {
-                Q.adjustHeap(v, du + w);
-                reference_fire_path.a[v] = du + w;
-                reference_fire_path.p[v] = u;
-            }
-        }
-    }
-    if(reference_objective != sol.objv){
-        cout << "Objective values don't match." << endl;
-        cout << "       Stored: " << sol.objv << "   Correct: " << reference_objective << endl;
-        exit(1);
-    }
-    for(unsigned u = 0; u < I.n; u++){
-        if(reference_fire_path.a[u] != sol.fire_path.a[u]){
-            cout << "Fire arrival time at node " << u << " is wrong." << endl;
-            cout << "       Stored: " << sol.fire_path.a[u] << "   Correct: " << reference_fire_path.a[u] << endl;
-            exit(1);
-        }
-    }
-}
+/*
+    Single-pass solution checker. Arrival times are correct exactly when they
+    satisfy Bellman's conditions: every node's arrival time is the minimum
+    of its own ignition time (if it is an ignition) and, over its incoming
+    arcs, the tail's arrival time plus the (possibly delayed) arc weight.
+    The predecessor of a node ignited by itself is the node. Arc weights are
+    positive, so the solution of these equations is unique. This is verified
+    with one scan of the CSR in-arcs, which also finds the arc to each
+    node's predecessor, so no shortest path has to be recomputed. The
+    scratch arrays are kept between calls and messages are only built on
+    failure, so a Verifier can check every new incumbent.
+*/
+class Verifier {
+   private:
+    Instance& _I;
+    ResourceSet _resource;
+    vector<unsigned> _remaining;
+    string _error;
 
-void check_feasibility(Solution& sol) {
-    Instance& I = sol.I;
-    ShortestPathTree& fire_path = sol.fire_path;
-    vector<pair<unsigned, unsigned>>& allocation = sol.allocation;
-    string& has_resource = sol.has_resource;
-    unsigned objv = sol.objv;
-    unsigned tts = sol.time_to_survival;
+    bool fail(const string& message) {
+        _error = message;
+        return false;
+    }
 
-    string resource(I.n, false);
-    map<unsigned, unsigned> bookkeeping;
-    for(auto const& [instant, quantity] : I.R)
-        bookkeeping[instant] = quantity;
+   public:
+    Verifier(Instance& I) : _I(I), _resource(I.n), _remaining(I.R.size()) {}
 
+    // Returns false and sets error() if 'sol' is infeasible or its statistics are wrong
+    bool check(const Solution& sol) {
+        const ShortestPathTree& fire_path = sol.fire_path;
+        _resource.clear();
+        for (unsigned r = 0; r < _I.R.size(); r++)
+            _remaining[r] = _I.R[r].second;
 
-    /*
-        Check if:
-            i) Each node received at most one resource
-            ii) At most |R_t| resources were deployed at time instant t
-            iii) A burned node didn't receive a resource
-    */
-    for (auto const& [node, instant] : allocation) {
-        if (resource[node]) {
-            cout << "Node " << I.get_node_signature(node) << " received a resource twice." << endl;
-            exit(1);
-        }else
-            resource[node] = true;
-        if(bookkeeping[instant] == 0){
-            cout << "More resources were deployed at instant " << instant << " than the available quantity." << endl;
-            exit(1);
-        }else
-            bookkeeping[instant]--;
-        if (fire_path.a[node] < instant) {
-            cout << "Node " << I.get_node_signature(node) << " received a resource after fire arrival." << endl;
-            exit(1);
+        /*
+            Check if:
+                i) Each node received at most one resource
+                ii) At most |R_t| resources were deployed at time instant t
+                iii) A burned node didn't receive a resource
+        */
+        for (auto const& [node, instant] : sol.allocation) {
+            if (_resource[node])
+                return fail("Node " + _I.get_node_signature(node) + " received a resource twice.");
+            _resource.set(node);
+            auto r = lower_bound(_I.R.begin(), _I.R.end(), make_pair(instant, 0u));
+            if (r == _I.R.end() || r->first != instant || _remaining[r - _I.R.begin()] == 0)
+                return fail("More resources were deployed at instant " + to_string(instant) + " than the available quantity.");
+            _remaining[r - _I.R.begin()]--;
+            if (fire_path.a[node] < instant)
+                return fail("Node " + _I.get_node_signature(node) + " received a resource after fire arrival.");
         }
-    }
 
-    // Check if 'has_resource' and 'allocation' are consistent
-    if(resource != has_resource){
-        cout << "'has_resource' and 'allocation' are inconsistent." << endl;
-        exit(1);
-    }
+        // Check if 'has_resource' and 'allocation' are consistent
+        if (_resource != sol.has_resource)
+            return fail("'has_resource' and 'allocation' are inconsistent.");
 
-    // Check if the shortest-path tree is correct
-    unsigned burned_nodes = 0;
-    unsigned time_to_survival = 0;
-    for (unsigned node = 0; node < I.n; node++) {
-        unsigned pred_n = fire_path.p[node]; 
-        string pred_sig = I.get_node_signature(pred_n);
-        string n_sig = I.get_node_signature(node);
-        if (node != I.ign) {
-            if(node == pred_n){
-                cout << "Node " << n_sig << " does not have a predecessor."<< endl;
-                exit(1);
+        // Check the shortest-path tree and recompute the statistics
+        unsigned burned_nodes = 0;
+        unsigned time_to_survival = 0;
+        for (unsigned node = 0; node < _I.n; node++) {
+            unsigned pred_n = fire_path.p[node];
+            unsigned a = fire_path.a[node];
+            unsigned start = _I.ignition_time[node];
+            if (start < a)
+                return fail("Fire arrival time at node " + _I.get_node_signature(node) + " is after its ignition at " + to_string(start) + ".");
+            if (node == pred_n) {
+                if (start == NO_IGNITION)
+                    return fail("Node " + _I.get_node_signature(node) + " does not have a predecessor.");
+                if (a != start)
+                    return fail("Fire arrival time at ignition node " + _I.get_node_signature(node) + " is not its start time.");
+            } else {
+                bool tight = false;
+                for (const Arc& e : _I.get_incoming_arcs(node)) {
+                    unsigned u = e.node;
+                    unsigned candidate = fire_path.a[u] + e.weight + (_resource[u] ? _I.Delta : 0);
+                    if (candidate < a)
+                        return fail("Fire arrival time at node " + _I.get_node_signature(node) + " is wrong. Stored: " +
+                                    to_string(a) + "   Reachable from " + _I.get_node_signature(u) + " at: " + to_string(candidate));
+                    tight |= u == pred_n && candidate == a;
+                }
+                if (!tight)
+                    return fail("Inconsistent fire arrival times between nodes " + _I.get_node_signature(pred_n) + " and " +
+                                _I.get_node_signature(node));
             }
-            unsigned delta = resource[pred_n] ? I.Delta : 0;
-            if (fire_path.a[node] != fire_path.a[pred_n] + delta + I.get_edge_cost(pred_n, node)) {
-                cout << "Inconsistent fire arrival times between nodes " << pred_sig << " and " << n_sig << endl;
-                exit(1);
-            }
-        }else{
-            if (fire_path.a[node] != 0) {
-                cout << "Fire arrival time at ignition node is not zero."<< endl;
-                exit(1);
-            }
-            if (node != pred_n) {
-                cout << "Ignition node is not the predecessor of itself."<< endl;
-                exit(1);
+            if (a < _I.H) {
+                burned_nodes++;
+                time_to_survival += _I.H - a;
             }
         }
-        if(fire_path.a[node] < I.H)
-            burned_nodes++;
-        time_to_survival += max(int(I.H) - int(fire_path.a[node]), 0);
-    }
 
-    if(burned_nodes != objv){
-        cout << "Objective value is incorrect! The current value is " << objv << " but the correct value is " << burned_nodes << endl;
-        exit(1);
+        if (burned_nodes != sol.objv)
+            return fail("Objective value is incorrect! The current value is " + to_string(sol.objv) +
+                        " but the correct value is " + to_string(burned_nodes));
+        if (time_to_survival != sol.time_to_survival)
+            return fail("Time to survival is incorrect! The current value is " + to_string(sol.time_to_survival) +
+                        " but the correct value is " + to_string(time_to_survival));
+        return true;
     }
-    if(time_to_survival != tts){
-        cout << "Time to survival is incorrect! The current value is " << tts << " but the correct value is " << time_to_survival << endl;
+
+    const string& error() const { return _error; }
+};
+
+void check_feasibility(Solution& sol) {
+    Verifier verifier(sol.I);
+    if (!verifier.check(sol)) {
+        cout << verifier.error() << endl;
         exit(1);
     }
-    
-    // Check if fire arrival times are correct
-    dijkstra(sol);
-}
\ No newline at end of file
+}
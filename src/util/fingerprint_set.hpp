@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Open-addressing hash set of 64-bit fingerprints with linear probing. Slots
+// holding zero are empty, so the zero key is tracked separately. clear()
+// keeps the table, so a set reused across calls stops allocating once it
+// has grown to the working size.
+class FingerprintSet {
+   private:
+    vector<uint64_t> table;
+    uint64_t mask;
+    unsigned count;
+    bool has_zero;
+
+    inline uint64_t slot(uint64_t key) const {
+        // Fibonacci hashing spreads keys that differ only in their high bits
+        return (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+    }
+
+    void grow() {
+        vector<uint64_t> old = std::move(table);
+        table = vector<uint64_t>(old.size() * 2, 0);
+        mask = table.size() - 1;
+        for (uint64_t key : old)
+            if (key != 0) {
+                uint64_t i = slot(key);
+                while (table[i] != 0)
+                    i = (i + 1) & mask;
+                table[i] = key;
+            }
+    }
+
+   public:
+    FingerprintSet(unsigned capacity = 64) : count(0), has_zero(false) {
+        unsigned size = 16;
+        while (size < 2 * capacity)
+            size *= 2;
+        table = vector<uint64_t>(size, 0);
+        mask = size - 1;
+    }
+
+    // Returns true if 'key' was not in the set
+    bool insert(uint64_t key) {
+        if (key == 0) {
+            bool inserted = !has_zero;
+            has_zero = true;
+            return inserted;
+        }
+        uint64_t i = slot(key);
+        while (table[i] != 0) {
+            if (table[i] == key)
+                return false;
+            i = (i + 1) & mask;
+        }
+        table[i] = key;
+        if (++count * 2 > table.size())
+            grow();
+        return true;
+    }
+
+    bool contains(uint64_t key) const {
+        if (key == 0)
+            return has_zero;
+        uint64_t i = slot(key);
+        while (table[i] != 0) {
+            if (table[i] == key)
+                return true;
+            i = (i + 1) & mask;
+        }
+        return false;
+    }
+
+    void clear() {
+        if (count > 0)
+            fill(table.begin(), table.end(), 0);
+        count = 0;
+        has_zero = false;
+    }
+
+    inline unsigned size() const { return count + has_zero; }
+};
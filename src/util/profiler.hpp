@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+/*
+    Hot-path instrumentation. Counters and timers are only compiled in when
+    PROFILE is defined (cmake -DPROFILE=ON); otherwise PROFILE_SCOPE and
+    PROFILE_COUNT expand to nothing and the search loop is left untouched.
+*/
+#ifdef PROFILE
+#define PROFILE_SCOPE(profile, phase) ScopedTimer _scoped_timer_##phase((profile), Phase::phase)
+#define PROFILE_COUNT(statement) statement
+#else
+#define PROFILE_SCOPE(profile, phase)
+#define PROFILE_COUNT(statement)
+#endif
+
+// Phases are nested: 'delta' and 'add_resource' include 'update_subtree', 'trials' includes 'delta' and 'scenarios'
+enum class Phase { candidates, trials, delta, scenarios, add_resource, update_subtree, prune, COUNT };
+constexpr std::array<const char*, size_t(Phase::COUNT)> PHASE_NAMES = {"candidates", "trials", "delta", "scenarios", "add_resource", "update_subtree", "prune"};
+
+struct Profile {
+    // Per-level sums, indexed by the position of the instant in Instance::R
+    struct Level {
+        unsigned long long int parents = 0;
+        unsigned long long int children = 0;
+        unsigned long long int F = 0;
+        unsigned long long int N = 0;
+    };
+
+    std::array<double, size_t(Phase::COUNT)> wall_time = {};
+    std::array<unsigned long long int, size_t(Phase::COUNT)> calls = {};
+    unsigned long long int heap_pushes = 0;
+    unsigned long long int heap_updates = 0;
+    unsigned long long int heap_pops = 0;
+    unsigned long long int cache_lookups = 0;
+    unsigned long long int cache_hits = 0;
+    vector<unsigned long long int> affected_nodes; // Bucket b counts updates touching [2^(b-1), 2^b) nodes; bucket 0 counts none
+    vector<Level> levels;
+
+    void add_affected(size_t count) {
+        unsigned b = 0;
+        while (count >> b)
+            b++;
+        if (affected_nodes.size() <= b)
+            affected_nodes.resize(b + 1, 0);
+        affected_nodes[b]++;
+    }
+
+    Level& level(unsigned idx) {
+        if (levels.size() <= idx)
+            levels.resize(idx + 1);
+        return levels[idx];
+    }
+
+    void merge(const Profile& other) {
+        for (size_t p = 0; p < wall_time.size(); p++) {
+            wall_time[p] += other.wall_time[p];
+            calls[p] += other.calls[p];
+        }
+        heap_pushes += other.heap_pushes;
+        heap_updates += other.heap_updates;
+        heap_pops += other.heap_pops;
+        cache_lookups += other.cache_lookups;
+        cache_hits += other.cache_hits;
+        if (affected_nodes.size() < other.affected_nodes.size())
+            affected_nodes.resize(other.affected_nodes.size(), 0);
+        for (size_t b = 0; b < other.affected_nodes.size(); b++)
+            affected_nodes[b] += other.affected_nodes[b];
+        for (size_t l = 0; l < other.levels.size(); l++) {
+            Level& mine = level(l);
+            mine.parents += other.levels[l].parents;
+            mine.children += other.levels[l].children;
+            mine.F += other.levels[l].F;
+            mine.N += other.levels[l].N;
+        }
+    }
+
+    json to_json() const {
+        json data;
+#ifdef PROFILE
+        data["enabled"] = true;
+#else
+        data["enabled"] = false;
+#endif
+        for (size_t p = 0; p < wall_time.size(); p++)
+            data["phases"][PHASE_NAMES[p]] = {{"seconds", wall_time[p]}, {"calls", calls[p]}};
+        data["heap"] = {{"pushes", heap_pushes}, {"updates", heap_updates}, {"pops", heap_pops}};
+        data["cache"] = {{"lookups", cache_lookups}, {"hits", cache_hits},
+                         {"hit_rate", cache_lookups ? double(cache_hits) / cache_lookups : 0.0}};
+        data["affected_nodes"] = json::array();
+        for (size_t b = 0; b < affected_nodes.size(); b++)
+            data["affected_nodes"].push_back({{"less_than", 1ull << b}, {"updates", affected_nodes[b]}});
+        data["levels"] = json::array();
+        for (const Level& l : levels) {
+            double parents = max(l.parents, 1ull);
+            data["levels"].push_back({{"parents", l.parents}, {"children", l.children},
+                                      {"mean_F", l.F / parents}, {"mean_N", l.N / parents}});
+        }
+        return data;
+    }
+};
+
+class ScopedTimer {
+   private:
+    Profile& _profile;
+    Phase _phase;
+    chrono::steady_clock::time_point _start;
+
+   public:
+    ScopedTimer(Profile& profile, Phase phase) : _profile(profile), _phase(phase), _start(chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        _profile.wall_time[size_t(_phase)] += chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+        _profile.calls[size_t(_phase)]++;
+    }
+};
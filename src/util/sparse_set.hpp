@@ -0,0 +1,61 @@
+#pragma once
+
+#include <limits>
+#include <random>
+#include <vector>
+using namespace std;
+
+// Set of integers in [0, n) stored as a dense array plus a position index.
+// Insert, erase, membership and uniform sampling are O(1); erase does not
+// preserve the order of the remaining elements.
+class SparseSet {
+   private:
+    static constexpr unsigned NONE = numeric_limits<unsigned>::max();
+    vector<unsigned> dense;
+    vector<unsigned> pos;
+
+   public:
+    SparseSet(unsigned n = 0) : pos(n, NONE) { dense.reserve(n); }
+
+    inline bool contains(unsigned v) const { return pos[v] != NONE; }
+
+    inline void insert(unsigned v) {
+        if (pos[v] != NONE)
+            return;
+        pos[v] = dense.size();
+        dense.push_back(v);
+    }
+
+    inline void erase(unsigned v) {
+        unsigned idx = pos[v];
+        if (idx == NONE)
+            return;
+        unsigned last = dense.back();
+        dense[idx] = last;
+        pos[last] = idx;
+        dense.pop_back();
+        pos[v] = NONE;
+    }
+
+    void clear() {
+        for (unsigned v : dense)
+            pos[v] = NONE;
+        dense.clear();
+    }
+
+    inline unsigned operator[](unsigned idx) const { return dense[idx]; }
+
+    template <typename RNG>
+    inline unsigned sample(RNG& gen) const {
+        uniform_int_distribution<> dist(0, dense.size() - 1);
+        return dense[dist(gen)];
+    }
+
+    inline unsigned size() const { return dense.size(); }
+
+    inline bool empty() const { return dense.empty(); }
+
+    inline vector<unsigned>::const_iterator begin() const { return dense.begin(); }
+
+    inline vector<unsigned>::const_iterator end() const { return dense.end(); }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+using namespace std;
+
+// Writes lines to a file or FIFO from a background thread. post() only queues
+// the job that formats a line, so the caller never waits for formatting, for
+// the disk or for a FIFO reader. Lines are flushed as soon as the queue is
+// drained.
+class StreamWriter {
+   private:
+    // Owned jointly with the thread, which may outlive the writer (see the destructor)
+    struct Queue {
+        mutex m;
+        condition_variable cv;
+        deque<std::function<void(ostream&)>> jobs;
+        atomic<bool> opened = false;
+        bool stop = false;
+    };
+    std::shared_ptr<Queue> _q;
+    thread _thread;
+
+    static void loop(std::shared_ptr<Queue> q, string path) {
+        // Opening a FIFO blocks until a reader attaches
+        ofstream out(path);
+        q->opened = true;
+        if (!out.good())
+            cerr << "Could not open stream: " << path << endl;
+        while (true) {
+            std::function<void(ostream&)> job;
+            bool drained;
+            {
+                unique_lock<mutex> lock(q->m);
+                q->cv.wait(lock, [&] { return q->stop || !q->jobs.empty(); });
+                if (q->jobs.empty())
+                    return;
+                job = std::move(q->jobs.front());
+                q->jobs.pop_front();
+                drained = q->jobs.empty();
+            }
+            job(out);
+            if (drained)
+                out.flush();
+        }
+    }
+
+   public:
+    StreamWriter(const string& path) : _q(std::make_shared<Queue>()) {
+        _thread = thread(loop, _q, path);
+    }
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // Writes the pending lines and closes the stream. A FIFO that never got a reader
+    // is abandoned rather than waited for, and its pending lines are dropped, so no job
+    // runs after the writer is gone.
+    ~StreamWriter() {
+        {
+            lock_guard<mutex> lock(_q->m);
+            _q->stop = true;
+            if (!_q->opened)
+                _q->jobs.clear();
+        }
+        _q->cv.notify_one();
+        if (_q->opened)
+            _thread.join();
+        else
+            _thread.detach();
+    }
+
+    void post(std::function<void(ostream&)> job) {
+        {
+            lock_guard<mutex> lock(_q->m);
+            _q->jobs.push_back(std::move(job));
+        }
+        _q->cv.notify_one();
+    }
+};
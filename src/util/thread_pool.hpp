@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// Fixed-size pool of worker threads. The calling thread takes part in every
+// parallel_for as worker 0, so a pool of size 1 never spawns a thread.
+class ThreadPool {
+   private:
+    vector<thread> _threads;
+    mutex _m;
+    condition_variable _cv_start;
+    condition_variable _cv_done;
+    // Job of the running parallel_for: the caller's callable, which outlives the call, and how to invoke it
+    void* _job;
+    void (*_invoke)(void*, unsigned, unsigned);
+    atomic<unsigned> _next;
+    unsigned _n_tasks;
+    unsigned _generation;
+    unsigned _running;
+    bool _stop;
+
+    void run_tasks(unsigned worker) {
+        for (unsigned idx = _next++; idx < _n_tasks; idx = _next++)
+            _invoke(_job, idx, worker);
+    }
+
+    void loop(unsigned worker) {
+        unsigned seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(_m);
+                _cv_start.wait(lock, [&] { return _stop || _generation != seen; });
+                if (_stop)
+                    return;
+                seen = _generation;
+            }
+            run_tasks(worker);
+            {
+                lock_guard<mutex> lock(_m);
+                if (--_running == 0)
+                    _cv_done.notify_one();
+            }
+        }
+    }
+
+   public:
+    ThreadPool(unsigned n_threads) : _job(nullptr), _invoke(nullptr), _next(0), _n_tasks(0), _generation(0), _running(0), _stop(false) {
+        for (unsigned t = 1; t < max(n_threads, 1u); t++)
+            _threads.emplace_back(&ThreadPool::loop, this, t);
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(_m);
+            _stop = true;
+        }
+        _cv_start.notify_all();
+        for (thread& t : _threads)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline unsigned size() { return _threads.size() + 1; }
+
+    // Calls f(idx, worker) for every idx in [0, n). Indices are handed out
+    // dynamically, so f must not depend on which worker runs a given index.
+    // f is used in place, so a call does not allocate.
+    template <class F>
+    void parallel_for(unsigned n, F&& f) {
+        using Fn = std::remove_reference_t<F>;
+        if (_threads.empty() || n <= 1) {
+            for (unsigned idx = 0; idx < n; idx++)
+                f(idx, 0);
+            return;
+        }
+        {
+            lock_guard<mutex> lock(_m);
+            _job = (void*)std::addressof(f);
+            _invoke = [](void* job, unsigned idx, unsigned worker) { (*static_cast<Fn*>(job))(idx, worker); };
+            _n_tasks = n;
+            _next = 0;
+            _running = _threads.size();
+            _generation++;
+        }
+        _cv_start.notify_all();
+        run_tasks(0);
+        unique_lock<mutex> lock(_m);
+        _cv_done.wait(lock, [&] { return _running == 0; });
+        _job = nullptr;
+        _invoke = nullptr;
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// Keeps the k smallest keys of a stream. Ties are broken by the order in
+// which the keys were offered, so the selection is deterministic. Every
+// kept key owns a slot in [0, k) where the caller stores its payload; the
+// slot of an evicted key is handed to the key that replaces it. Offering
+// m keys costs O(m log k) and memory stays bounded by k.
+template <typename Key>
+class TopK {
+   public:
+    static constexpr unsigned NONE = numeric_limits<unsigned>::max();
+
+    struct Entry {
+        Key key;
+        unsigned order;
+        unsigned slot;
+        bool operator<(const Entry& other) const {
+            return key < other.key || (key == other.key && order < other.order);
+        }
+    };
+
+   private:
+    vector<Entry> heap; // Max-heap, so the worst kept key is at the front
+    unsigned k;
+    unsigned offered;
+
+   public:
+    TopK(unsigned _k = 0) : k(_k), offered(0) { heap.reserve(k); }
+
+    void reset(unsigned _k) {
+        heap.clear();
+        k = _k;
+        offered = 0;
+    }
+
+    // Returns the slot where the payload of 'key' goes, or NONE if it was not kept
+    unsigned offer(const Key& key) {
+        Entry e = {key, offered++, unsigned(heap.size())};
+        if (heap.size() < k) {
+            heap.push_back(e);
+            push_heap(heap.begin(), heap.end());
+            return e.slot;
+        }
+        if (k == 0 || !(e < heap.front()))
+            return NONE;
+        pop_heap(heap.begin(), heap.end());
+        e.slot = heap.back().slot;
+        heap.back() = e;
+        push_heap(heap.begin(), heap.end());
+        return e.slot;
+    }
+
+    // Sorts the kept entries from best to worst; offering more keys afterwards requires a reset
+    const vector<Entry>& sorted() {
+        sort_heap(heap.begin(), heap.end());
+        return heap;
+    }
+
+    inline unsigned size() const { return heap.size(); }
+
+    inline bool empty() const { return heap.empty(); }
+};
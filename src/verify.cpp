@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "instance.hpp"
+#include "solution.hpp"
+#include "feasibility.hpp"
+#include "thread_pool.hpp"
+
+
+int main(int argc, char *argv[]) {
+    // 1) Parse input
+    string solutions_dir, instances_dir;
+    unsigned threads;
+    po::options_description general("General options");
+    general.add_options()("help", "Show this message.")
+                         ("solutions", po::value<string>(&solutions_dir), "Directory holding the Sol_<name>.json files.")
+                         ("instances", po::value<string>(&instances_dir)->default_value("./instances"), "Directory holding <name>.bin or <name>.json.")
+                         ("threads", po::value<unsigned>(&threads)->default_value(thread::hardware_concurrency()), "Number of solutions checked at the same time.");
+    po::positional_options_description pod;
+    pod.add("solutions", 1);
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(general).positional(pod).run(), vm);
+    po::notify(vm);
+    if (vm.count("help") || !vm.count("solutions")) {
+        cout << "Checks the feasibility and the statistics of saved solutions." << endl;
+        cout << general << endl;
+        return !vm.count("help");
+    }
+
+    // 2) Collect the solution files
+    vector<string> names;
+    for (const auto& entry : filesystem::directory_iterator(solutions_dir)) {
+        string file = entry.path().filename().string();
+        if (entry.is_regular_file() && file.rfind("Sol_", 0) == 0 && entry.path().extension() == ".json")
+            names.push_back(file.substr(4, file.size() - 9));
+    }
+    sort(names.begin(), names.end());
+
+    // 3) Check them in parallel; the binary format is preferred when both exist
+    vector<string> reports(names.size());
+    vector<char> ok(names.size(), false);
+    ThreadPool pool(max(1u, threads));
+    pool.parallel_for(names.size(), [&](unsigned idx, unsigned) {
+        string instance = instances_dir + "/" + names[idx] + ".bin";
+        if (!filesystem::exists(instance))
+            instance = instances_dir + "/" + names[idx] + ".json";
+        if (!filesystem::exists(instance)) {
+            reports[idx] = "instance not found";
+            return;
+        }
+        try {
+            Instance I;
+            I.read_instance(instance);
+            Solution sol(solutions_dir + "/Sol_" + names[idx] + ".json", I);
+            Verifier verifier(I);
+            ok[idx] = verifier.check(sol);
+            reports[idx] = ok[idx] ? "ok (objv " + to_string(sol.objv) + ")" : verifier.error();
+        } catch (const std::exception& e) {
+            reports[idx] = e.what();
+        }
+    });
+
+    // 4) Report
+    unsigned failed = 0;
+    for (unsigned idx = 0; idx < names.size(); idx++) {
+        cout << names[idx] << ": " << reports[idx] << endl;
+        failed += !ok[idx];
+    }
+    cout << names.size() - failed << "/" << names.size() << " solutions are feasible." << endl;
+    return failed > 0;
+}